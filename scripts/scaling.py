@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Strong and weak scaling of the solver kernels, measured with prion_bench.
+
+The times are those of the kernels timed in isolation by prion_bench
+(assembly, linear solves, ghost update and output), not those of the timer
+sections of a full solver run.
+
+Strong scaling runs the half-brain mesh on every rank count. Weak scaling
+runs the cube mesh, refined so that the number of cells per rank stays about
+the same as on the smallest rank count. Every run writes a JSON file with the
+kernel times. This script merges those files into a single report and adds the
+parallel efficiency of each kernel, relative to the smallest rank count:
+  strong: E(p) = T(p_0) p_0 / (T(p) p),
+  weak:   E(p) = T(p_0) / T(p).
+
+Example, from the build directory (the brain mesh is ../mesh/half-brain.msh):
+  python3 ../scripts/scaling.py --ranks 1 2 4 8 --output scaling.json
+"""
+
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+
+def run_bench(args, n_ranks, mesh, n_subdivisions):
+    """Run prion_bench on n_ranks processes and return its JSON report."""
+    with tempfile.TemporaryDirectory() as directory:
+        report_file = os.path.join(directory, "bench.json")
+        command = (
+            [args.mpirun, "-n", str(n_ranks)]
+            + shlex.split(args.mpirun_args)
+            + [
+                args.bench,
+                str(args.repetitions),
+                mesh,
+                str(n_subdivisions),
+                report_file,
+            ]
+        )
+        print("Running: " + " ".join(command), flush=True)
+
+        result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                universal_newlines=True)
+        if result.returncode != 0:
+            sys.stderr.write(result.stdout)
+            raise RuntimeError("prion_bench failed on %d ranks" % n_ranks)
+
+        with open(report_file) as file:
+            return json.load(file)
+
+
+def add_efficiency(runs, weak):
+    """Add the parallel efficiency of each kernel to the runs."""
+    reference = runs[0]
+    reference_times = {k["kernel"]: k["median"] for k in reference["kernels"]}
+
+    for run in runs:
+        for kernel in run["kernels"]:
+            t_0 = reference_times[kernel["kernel"]]
+            if weak:
+                kernel["efficiency"] = t_0 / kernel["median"]
+            else:
+                kernel["efficiency"] = (t_0 * reference["processes"]) / (
+                    kernel["median"] * run["processes"])
+
+
+def print_table(title, runs):
+    print(title)
+    for run in runs:
+        print("  %4d ranks, %9d cells, %9d cells per rank"
+              % (run["processes"], run["cells"], run["cells"] // run["processes"]))
+        for kernel in run["kernels"]:
+            print("    %-30s %10.3e s  efficiency %5.2f"
+                  % (kernel["kernel"], kernel["median"], kernel["efficiency"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--bench", default="./prion_bench", help="prion_bench executable")
+    parser.add_argument("--mpirun", default="mpirun", help="MPI launcher")
+    parser.add_argument("--mpirun-args", default="",
+                        help="extra launcher arguments, e.g. \"--oversubscribe\"")
+    parser.add_argument("--ranks", type=int, nargs="+", default=[1, 2, 4],
+                        help="rank counts (the first one is the reference)")
+    parser.add_argument("--repetitions", type=int, default=5,
+                        help="repetitions of each kernel")
+    parser.add_argument("--brain-mesh", default="brain",
+                        help="mesh of the strong scaling runs (\"brain\" for the default)")
+    parser.add_argument("--cube-n", type=int, default=19,
+                        help="N of the cube mesh on the reference rank count")
+    parser.add_argument("--skip-strong", action="store_true")
+    parser.add_argument("--skip-weak", action="store_true")
+    parser.add_argument("--output", default="scaling.json", help="JSON report")
+    args = parser.parse_args()
+
+    report = {"repetitions": args.repetitions}
+
+    if not args.skip_strong:
+        runs = [run_bench(args, p, args.brain_mesh, 0) for p in args.ranks]
+        add_efficiency(runs, weak=False)
+        report["strong"] = {"mesh": args.brain_mesh, "runs": runs}
+        print_table("Strong scaling (%s)" % args.brain_mesh, runs)
+
+    if not args.skip_weak:
+        # The cube mesh is made of (N + 1)^3 hexahedra, each split into 24
+        # tetrahedra, i.e. 24 (N + 1)^3 cells: N + 1 grows with the cube root
+        # of the number of ranks.
+        cells_per_rank = 24 * (args.cube_n + 1) ** 3 / args.ranks[0]
+        runs = []
+        for p in args.ranks:
+            n = max(round((cells_per_rank * p / 24) ** (1.0 / 3.0)) - 1, 0)
+            run = run_bench(args, p, "cube", n)
+            run["N"] = n
+            run["cells_per_rank"] = run["cells"] / p
+            runs.append(run)
+        add_efficiency(runs, weak=True)
+        report["weak"] = {"mesh": "cube", "runs": runs}
+        print_table("Weak scaling (cube)", runs)
+
+    with open(args.output, "w") as file:
+        json.dump(report, file, indent=2)
+    print("Report written to " + args.output)
+
+
+if __name__ == "__main__":
+    main()
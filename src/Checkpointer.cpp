@@ -0,0 +1,244 @@
+#include "Checkpointer.hpp"
+
+#include <deal.II/base/exceptions.h>
+#include <deal.II/base/utilities.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace {
+  // Read the metadata file as a map from keys to values.
+  std::map<std::string, std::string>
+  read_metadata(const std::string &file_name) {
+    std::ifstream file(file_name);
+    AssertThrow(file, ExcMessage("Could not open the checkpoint file " + file_name));
+
+    std::map<std::string, std::string> result;
+    std::string                        key;
+    std::string                        value;
+    while (file >> key >> value)
+      result[key] = value;
+
+    return result;
+  }
+} // namespace
+
+Checkpointer::Checkpointer(const MPI_Comm &mpi_comm_, const std::string &directory_) :
+  mpi_comm(mpi_comm_),
+  mpi_size(Utilities::MPI::n_mpi_processes(mpi_comm)),
+  mpi_rank(Utilities::MPI::this_mpi_process(mpi_comm)),
+  directory(directory_) {
+  // If the directory has a checkpoint already (e.g. when restarting from it),
+  // the slot it uses is preserved.
+  if (std::ifstream(directory + "/checkpoint.info"))
+    slot = 1 - std::stoul(read_metadata(directory + "/checkpoint.info").at("slot"));
+}
+
+Checkpointer::~Checkpointer() {
+  if (thread.joinable())
+    thread.join();
+}
+
+std::string
+Checkpointer::vectors_file_name(const unsigned int &slot_) const {
+  return directory + "/vectors-" + std::to_string(slot_) + "." +
+         Utilities::int_to_string(mpi_rank, 4);
+}
+
+void
+Checkpointer::save_mesh(
+  const TriangulationDescription::Description<dim, dim> &description) const {
+  // Written to a temporary file first, so that the file of the committed
+  // checkpoint is never replaced by a partial one (e.g. when restarting into
+  // the same directory).
+  const std::string file_name =
+    directory + "/mesh." + Utilities::int_to_string(mpi_rank, 4);
+
+  {
+    std::ofstream file(file_name + ".tmp", std::ios::binary);
+    AssertThrow(file, ExcMessage("Could not create the checkpoint file " + file_name));
+
+    {
+      boost::archive::binary_oarchive archive(file);
+      archive << description;
+    }
+
+    file.close();
+    AssertThrow(file, ExcMessage("Could not write the checkpoint file " + file_name));
+  }
+
+  AssertThrow(std::rename((file_name + ".tmp").c_str(), file_name.c_str()) == 0,
+              ExcMessage("Could not rename the checkpoint file " + file_name));
+}
+
+TriangulationDescription::Description<dim, dim>
+Checkpointer::load_mesh() const {
+  const auto metadata = read_metadata(directory + "/checkpoint.info");
+  AssertThrow(std::stoul(metadata.at("n_processes")) == mpi_size,
+              ExcMessage("The checkpoint was written by " + metadata.at("n_processes") +
+                         " processes, and must be read by as many."));
+
+  const std::string file_name =
+    directory + "/mesh." + Utilities::int_to_string(mpi_rank, 4);
+
+  std::ifstream file(file_name, std::ios::binary);
+  AssertThrow(file, ExcMessage("Could not open the checkpoint file " + file_name));
+
+  TriangulationDescription::Description<dim, dim> description;
+  boost::archive::binary_iarchive                 archive(file);
+  archive >> description;
+
+  return description;
+}
+
+void
+Checkpointer::save(std::vector<std::vector<double>> &&values_, const State &state_) {
+  // The previous checkpoint is completed before its buffers are reused.
+  if (pending)
+    commit(true);
+
+  values  = std::move(values_);
+  state   = state_;
+  pending = true;
+  done.store(false, std::memory_order_relaxed);
+
+  thread = std::thread([this]() {
+    try {
+      write_vectors();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    done.store(true, std::memory_order_release);
+  });
+}
+
+void
+Checkpointer::write_vectors() const {
+  // Written to a temporary file first, so that a complete file is never
+  // replaced by a partial one.
+  const std::string file_name = vectors_file_name(slot);
+
+  {
+    std::ofstream file(file_name + ".tmp", std::ios::binary);
+    AssertThrow(file, ExcMessage("Could not create the checkpoint file " + file_name));
+
+    const std::uint64_t n_vectors = values.size();
+    file.write(reinterpret_cast<const char *>(&n_vectors), sizeof(n_vectors));
+
+      for (const auto &vector : values) {
+        const std::uint64_t size = vector.size();
+        file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char *>(vector.data()), size * sizeof(double));
+      }
+
+    file.close();
+    AssertThrow(file, ExcMessage("Could not write the checkpoint file " + file_name));
+  }
+
+  AssertThrow(std::rename((file_name + ".tmp").c_str(), file_name.c_str()) == 0,
+              ExcMessage("Could not rename the checkpoint file " + file_name));
+}
+
+void
+Checkpointer::commit(const bool &wait) {
+  if (!pending)
+    return;
+
+  if (wait && thread.joinable())
+    thread.join();
+
+  // Whether this process is done, and whether it succeeded. The exception is
+  // only read once the thread is known to be done with it.
+  const bool                finished = done.load(std::memory_order_acquire);
+  std::vector<unsigned int> status   = {finished ? 1u : 0u,
+                                        finished && exception ? 0u : 1u};
+  Utilities::MPI::min(status, mpi_comm, status);
+
+  if (status[0] == 0)
+    return;
+
+  if (thread.joinable())
+    thread.join();
+  pending = false;
+  values.clear();
+
+  AssertThrow(status[1] == 1, ExcMessage("A checkpoint could not be written."));
+
+    if (mpi_rank == 0) {
+      const std::string file_name = directory + "/checkpoint.info";
+
+      {
+        std::ofstream file(file_name + ".tmp");
+        AssertThrow(file, ExcMessage("Could not create the file " + file_name));
+
+        std::string triggers_fired = "-";
+        for (const bool fired : state.triggers_fired)
+          triggers_fired += fired ? '1' : '0';
+
+        file << std::setprecision(17) << "n_processes " << mpi_size << '\n'
+             << "slot " << slot << '\n'
+             << "time " << state.time << '\n'
+             << "deltat " << state.deltat << '\n'
+             << "deltat_old " << state.deltat_old << '\n'
+             << "last_output_time " << state.last_output_time << '\n'
+             << "time_step " << state.time_step << '\n'
+             << "output_index " << state.output_index << '\n'
+             << "triggers_fired " << triggers_fired << '\n';
+
+        file.close();
+        AssertThrow(file, ExcMessage("Could not write the file " + file_name));
+      }
+
+      AssertThrow(std::rename((file_name + ".tmp").c_str(), file_name.c_str()) == 0,
+                  ExcMessage("Could not rename the file " + file_name));
+    }
+
+  // The next checkpoint goes to the other slot.
+  slot = 1 - slot;
+}
+
+std::pair<std::vector<std::vector<double>>, Checkpointer::State>
+Checkpointer::load() const {
+  const auto metadata = read_metadata(directory + "/checkpoint.info");
+  AssertThrow(std::stoul(metadata.at("n_processes")) == mpi_size,
+              ExcMessage("The checkpoint was written by " + metadata.at("n_processes") +
+                         " processes, and must be read by as many."));
+
+  State result_state;
+  result_state.time             = std::stod(metadata.at("time"));
+  result_state.deltat           = std::stod(metadata.at("deltat"));
+  result_state.deltat_old       = std::stod(metadata.at("deltat_old"));
+  result_state.last_output_time = std::stod(metadata.at("last_output_time"));
+  result_state.time_step        = std::stoul(metadata.at("time_step"));
+  result_state.output_index     = std::stoul(metadata.at("output_index"));
+
+  // The value starts with "-", so that it is never empty.
+  const std::string triggers_fired = metadata.at("triggers_fired");
+  for (unsigned int k = 1; k < triggers_fired.size(); ++k)
+    result_state.triggers_fired.push_back(triggers_fired[k] == '1');
+
+  const std::string file_name = vectors_file_name(std::stoul(metadata.at("slot")));
+  std::ifstream     file(file_name, std::ios::binary);
+  AssertThrow(file, ExcMessage("Could not open the checkpoint file " + file_name));
+
+  std::uint64_t n_vectors = 0;
+  file.read(reinterpret_cast<char *>(&n_vectors), sizeof(n_vectors));
+
+  std::vector<std::vector<double>> result_values(n_vectors);
+    for (auto &vector : result_values) {
+      std::uint64_t size = 0;
+      file.read(reinterpret_cast<char *>(&size), sizeof(size));
+      vector.resize(size);
+      file.read(reinterpret_cast<char *>(vector.data()), size * sizeof(double));
+    }
+
+  AssertThrow(file, ExcMessage("Could not read the checkpoint file " + file_name));
+
+  return {result_values, result_state};
+}
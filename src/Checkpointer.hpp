@@ -0,0 +1,108 @@
+#ifndef CHECKPOINTER_HPP
+#define CHECKPOINTER_HPP
+
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/grid/tria_description.h>
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dealii;
+
+// Checkpoints of the time loop. Each process writes the description of its
+// part of the triangulation once, and at every checkpoint the local values of
+// the solution vectors, so that a run can be restarted on the same number of
+// processes without reading and partitioning the mesh again.
+//
+// Vectors are written by a background thread (without MPI calls) from a copy
+// of their values, into one of two slots, so that the last complete
+// checkpoint is never overwritten. Once all the processes have written their
+// files, the first one commits the checkpoint by writing the metadata file
+// (to a temporary file, renamed when complete).
+class Checkpointer {
+public:
+  // Physical dimension.
+  static constexpr unsigned int dim = 3;
+
+  // Scalar state of the time loop.
+  struct State {
+    double            time             = 0.0;
+    double            deltat           = 0.0;
+    double            deltat_old       = 0.0;
+    double            last_output_time = 0.0;
+    unsigned int      time_step        = 0;
+    unsigned int      output_index     = 0;
+    std::vector<bool> triggers_fired;
+  };
+
+  // Constructor.
+  Checkpointer(const MPI_Comm &mpi_comm_, const std::string &directory_);
+
+  // Destructor. Waits for the pending write, if any (without committing it).
+  ~Checkpointer();
+
+  // Write the triangulation description of this process.
+  void
+  save_mesh(const TriangulationDescription::Description<dim, dim> &description) const;
+
+  // Read the triangulation description of this process.
+  TriangulationDescription::Description<dim, dim>
+  load_mesh() const;
+
+  // Start writing a checkpoint with the given local vector values and state.
+  // A pending checkpoint is completed first. Collective.
+  void
+  save(std::vector<std::vector<double>> &&values, const State &state);
+
+  // Commit the pending checkpoint, if all the processes have written it. If
+  // wait is true, wait for them to do so. Collective.
+  void
+  commit(const bool &wait);
+
+  // Read the last committed checkpoint: local vector values and state.
+  std::pair<std::vector<std::vector<double>>, State>
+  load() const;
+
+protected:
+  // Name of the file of this process in the given slot.
+  std::string
+  vectors_file_name(const unsigned int &slot_) const;
+
+  // Write the vectors of the pending checkpoint (in the background thread).
+  void
+  write_vectors() const;
+
+  // MPI communicator.
+  const MPI_Comm mpi_comm;
+
+  // Number of MPI processes.
+  const unsigned int mpi_size;
+
+  // This MPI process.
+  const unsigned int mpi_rank;
+
+  // Checkpoint directory.
+  const std::string directory;
+
+  // Slot of the pending checkpoint.
+  unsigned int slot = 0;
+
+  // Whether a checkpoint is being written, or written but not committed.
+  bool pending = false;
+
+  // Local vector values and state of the pending checkpoint.
+  std::vector<std::vector<double>> values;
+  State                            state;
+
+  // Background thread, the exception it threw, if any, and whether it is done.
+  std::thread        thread;
+  std::exception_ptr exception;
+  std::atomic<bool>  done{false};
+};
+
+#endif
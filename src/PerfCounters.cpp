@@ -0,0 +1,157 @@
+#include "PerfCounters.hpp"
+
+#include <deal.II/base/utilities.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+namespace {
+  // Open an event of the calling thread, in the group of the given leader (-1
+  // for a new group, which starts disabled).
+  int
+  open_event(const std::uint32_t &type, const std::uint64_t &config, const int &group_fd) {
+    perf_event_attr attributes = {};
+    attributes.size            = sizeof(attributes);
+    attributes.type            = type;
+    attributes.config          = config;
+    attributes.disabled        = group_fd == -1 ? 1 : 0;
+    attributes.exclude_kernel  = 1;
+    attributes.exclude_hv      = 1;
+    attributes.read_format     = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                 PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attributes, 0, -1, group_fd, 0);
+  }
+} // namespace
+
+PerfCounters::PerfCounters(const MPI_Comm               &mpi_comm_,
+                           const std::vector<FlopEvent> &flop_events_) :
+  mpi_comm(mpi_comm_), flop_events(flop_events_) {
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> events = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}};
+  for (const auto &event : flop_events)
+    events.emplace_back(PERF_TYPE_RAW, event.config);
+
+    for (const auto &[type, config] : events) {
+      const int fd = open_event(type, config, fds.empty() ? -1 : fds.front());
+
+        if (fd < 0) {
+          for (const int &opened : fds)
+            close(opened);
+          fds.clear();
+          break;
+        }
+
+      fds.push_back(fd);
+    }
+
+  for (unsigned int s = 0; s < n_sections; ++s)
+    counts[s].assign(events.size(), 0.0);
+
+    if (!fds.empty()) {
+      ioctl(fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+  for (const int &fd : fds)
+    close(fd);
+}
+
+std::vector<double>
+PerfCounters::read() const {
+  // Layout of a group read: number of events, time enabled, time running and
+  // the value of each event.
+  std::vector<std::uint64_t> buffer(3 + fds.size(), 0);
+
+  if (fds.empty() ||
+      ::read(fds.front(), buffer.data(), buffer.size() * sizeof(std::uint64_t)) < 0)
+    return std::vector<double>(counts[0].size(), 0.0);
+
+  const double scale =
+    buffer[2] > 0 ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 0.0;
+
+  std::vector<double> result(fds.size());
+  for (unsigned int i = 0; i < fds.size(); ++i)
+    result[i] = static_cast<double>(buffer[3 + i]) * scale;
+
+  return result;
+}
+
+void
+PerfCounters::start(const Section &section) {
+  start_times[section]  = std::chrono::steady_clock::now();
+  start_values[section] = read();
+}
+
+void
+PerfCounters::stop(const Section &section) {
+  const std::vector<double> values = read();
+
+  for (unsigned int i = 0; i < values.size(); ++i)
+    counts[section][i] += values[i] - start_values[section][i];
+
+  times[section] += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                  start_times[section])
+                      .count();
+  ++calls[section];
+}
+
+void
+PerfCounters::print(ConditionalOStream &pcout) const {
+  static const std::array<std::string, n_sections> names = {
+    {"Assembly", "SpMV", "Preconditioner"}};
+
+  const unsigned int n_processes = Utilities::MPI::n_mpi_processes(mpi_comm);
+  const unsigned int n_available =
+    Utilities::MPI::sum(fds.empty() ? 0u : 1u, mpi_comm);
+
+  pcout << "===============================================" << std::endl;
+  pcout << "Hardware counters (" << n_available << " of " << n_processes
+        << " processes counting)" << std::endl;
+
+    for (unsigned int s = 0; s < n_sections; ++s) {
+      std::vector<double> total(counts[s].size());
+      Utilities::MPI::sum(counts[s], mpi_comm, total);
+      const unsigned int n_calls = Utilities::MPI::max(calls[s], mpi_comm);
+
+      // Time of the section on the slowest process.
+      const double time = Utilities::MPI::max(times[s], mpi_comm);
+
+      if (n_calls == 0 || n_available == 0)
+        continue;
+
+      const double ipc       = total[instructions] / std::max(total[cycles], 1.0);
+      const double miss_rate = total[cache_misses] / std::max(total[cache_references], 1.0);
+      const double bytes     = 64.0 * total[cache_misses];
+
+      pcout << "  " << std::left << std::setw(14) << names[s] << std::right << ": "
+            << n_calls << " calls, " << std::fixed << std::setprecision(3) << time
+            << " s, IPC = " << std::setprecision(2) << ipc
+            << ", cache miss rate = " << 100.0 * miss_rate
+            << "%, memory traffic = " << bytes / 1e9 << " GB ("
+            << bytes / 1e9 / std::max(time, 1e-9) << " GB/s)";
+
+        if (!flop_events.empty()) {
+          double flops = 0.0;
+          for (unsigned int i = 0; i < flop_events.size(); ++i)
+            flops += flop_events[i].flops * total[cache_misses + 1 + i];
+
+          pcout << ", " << flops / 1e9 / std::max(time, 1e-9) << " GFLOP/s, "
+                << flops / std::max(bytes, 1.0) << " FLOP/byte";
+        }
+
+      pcout << std::endl;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/mpi.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace dealii;
+
+// Hardware performance counters of the hot loops of the solver, read through
+// the Linux perf_event interface: cycles, instructions, last level cache
+// references and misses, and the floating point operations, if the raw events
+// counting them on this processor are given. The events of the calling thread
+// are read at the beginning and at the end of each instrumented section.
+//
+// Only built with the CMake option PRION_PERF_COUNTERS. If the events cannot
+// be opened (e.g. because of /proc/sys/kernel/perf_event_paranoid), the
+// process counts nothing, and the report says so.
+class PerfCounters {
+public:
+  // Instrumented sections.
+  enum Section : unsigned int { assembly, spmv, preconditioner, n_sections };
+
+  // Raw event counting floating point instructions, and operations per
+  // instruction (e.g. on x86, FP_ARITH_INST_RETIRED.SCALAR_DOUBLE is 0x01c7,
+  // with 1 operation, and .256B_PACKED_DOUBLE is 0x10c7, with 4).
+  struct FlopEvent {
+    std::uint64_t config;
+    double        flops;
+  };
+
+  // Counts the events of a section within its scope.
+  class Scope {
+  public:
+    Scope(PerfCounters &counters_, const Section &section_) :
+      counters(counters_), section(section_) {
+      counters.start(section);
+    }
+
+    ~Scope() {
+      counters.stop(section);
+    }
+
+  protected:
+    PerfCounters &counters;
+    const Section section;
+  };
+
+  // Operator whose products are counted in the given section, to wrap the
+  // matrix and the preconditioner passed to a solver.
+  template <typename Operator>
+  class Counted {
+  public:
+    Counted(const Operator &op_, PerfCounters &counters_, const Section &section_) :
+      op(op_), counters(counters_), section(section_) {}
+
+    template <typename VectorType>
+    void
+    vmult(VectorType &dst, const VectorType &src) const {
+      Scope scope(counters, section);
+      op.vmult(dst, src);
+    }
+
+  protected:
+    const Operator &op;
+    PerfCounters   &counters;
+    const Section   section;
+  };
+
+  // Constructor. Opens and starts the events.
+  PerfCounters(const MPI_Comm &mpi_comm_, const std::vector<FlopEvent> &flop_events_ = {});
+
+  // Destructor. Closes the events.
+  ~PerfCounters();
+
+  // Start counting a section.
+  void
+  start(const Section &section);
+
+  // Stop counting a section.
+  void
+  stop(const Section &section);
+
+  // Print, for each section, the counts summed over the processes and the
+  // derived metrics: instructions per cycle, cache miss rate, memory traffic
+  // (estimated as a 64 byte line per cache miss), GFLOP/s and arithmetic
+  // intensity, i.e. the coordinates of the section on a roofline. Collective.
+  void
+  print(ConditionalOStream &pcout) const;
+
+protected:
+  // Fixed events, followed by the floating point events.
+  enum Event : unsigned int { cycles, instructions, cache_references, cache_misses };
+
+  // Read the current values of the events (scaled, if they were multiplexed).
+  std::vector<double>
+  read() const;
+
+  // MPI communicator.
+  const MPI_Comm mpi_comm;
+
+  // Floating point events.
+  const std::vector<FlopEvent> flop_events;
+
+  // File descriptors of the events (the first one leads the group). Empty if
+  // the events are not available.
+  std::vector<int> fds;
+
+  // Values of the events and time at the start of each section.
+  std::array<std::vector<double>, n_sections>                   start_values;
+  std::array<std::chrono::steady_clock::time_point, n_sections> start_times;
+
+  // Accumulated counts, wall time (in seconds) and calls of each section.
+  std::array<std::vector<double>, n_sections> counts;
+  std::array<double, n_sections>              times = {};
+  std::array<unsigned int, n_sections>        calls = {};
+};
+
+#endif
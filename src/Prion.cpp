@@ -6,22 +6,72 @@ HeatNonLinear::setup() {
   timer.enter_subsection("Mesh initialization");
   {
     pcout << "Initializing the mesh" << std::endl;
-    Triangulation<dim> mesh_serial;
 
-    // GridGenerator::subdivided_hyper_cube(mesh_serial, N + 1, 0.0, 1.0, true);
-    // GridGenerator::convert_hypercube_to_simplex_mesh(mesh_serial, mesh_serial);
+    if (checkpoint_frequency > 0)
+      checkpointer = std::make_unique<Checkpointer>(mpi_comm, checkpoint_directory);
+
+      if (!restart_directory.empty()) {
+        // The description of the local part of the mesh is read from the
+        // checkpoint, so that the mesh is neither read nor partitioned.
+        pcout << "  Restarting from " << restart_directory << std::endl;
+
+        auto construction_data = Checkpointer(mpi_comm, restart_directory).load_mesh();
+        construction_data.comm = mpi_comm;
+        mesh.create_triangulation(construction_data);
+
+        if (checkpointer)
+          checkpointer->save_mesh(construction_data);
+      } else {
+        // Only the first process of each group builds the serial mesh, and
+        // sends their descriptions to the others in its group. The serial
+        // mesh is destroyed before the distributed one is created.
+        unsigned int group_size = mesh_group_size;
+
+          if (group_size == 0) {
+            // One group per node.
+            MPI_Comm node_comm;
+            MPI_Comm_split_type(
+              mpi_comm, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL, &node_comm);
+            group_size =
+              Utilities::MPI::max(Utilities::MPI::n_mpi_processes(node_comm), mpi_comm);
+            MPI_Comm_free(&node_comm);
+          }
+
+        pcout << "  Serial mesh built by one process out of " << group_size << std::endl;
+
+        const auto build_serial_mesh = [this](Triangulation<dim> &mesh_serial) {
+            if (mesh_file_name.empty()) {
+              Triangulation<dim> mesh_hex;
+              GridGenerator::subdivided_hyper_cube(mesh_hex, N + 1, 0.0, 1.0, true);
+              GridGenerator::convert_hypercube_to_simplex_mesh(mesh_hex, mesh_serial);
+            } else {
+              GridIn<dim> grid_in;
+              grid_in.attach_triangulation(mesh_serial);
+              std::ifstream grid_in_file(mesh_file_name);
+              AssertThrow(grid_in_file,
+                          ExcMessage("Could not open the mesh file " + mesh_file_name));
+              grid_in.read_msh(grid_in_file);
+            }
+
+          serial_mesh_memory = mesh_serial.memory_consumption();
+        };
 
-    GridIn<dim> grid_in;
-    grid_in.attach_triangulation(mesh_serial);
-    const std::string mesh_file_name = "../mesh/half-brain.msh";
-    std::ifstream     grid_in_file(mesh_file_name);
-    grid_in.read_msh(grid_in_file);
+        const auto partition_serial_mesh = [](Triangulation<dim> &mesh_serial,
+                                              const MPI_Comm     &comm,
+                                              const unsigned int /*group_size*/) {
+          GridTools::partition_triangulation(Utilities::MPI::n_mpi_processes(comm),
+                                             mesh_serial);
+        };
 
-    GridTools::partition_triangulation(mpi_size, mesh_serial);
-    const auto construction_data =
-      TriangulationDescription::Utilities::create_description_from_triangulation(
-        mesh_serial, MPI_COMM_WORLD);
-    mesh.create_triangulation(construction_data);
+        const auto construction_data =
+          TriangulationDescription::Utilities::
+            create_description_from_triangulation_in_groups<dim, dim>(
+              build_serial_mesh, partition_serial_mesh, mpi_comm, group_size);
+        mesh.create_triangulation(construction_data);
+
+        if (checkpointer)
+          checkpointer->save_mesh(construction_data);
+      }
 
     pcout << "  Number of elements = " << mesh.n_global_active_cells() << std::endl;
   }
@@ -68,7 +118,7 @@ HeatNonLinear::setup() {
 
     pcout << "  Initializing the sparsity pattern" << std::endl;
 
-    TrilinosWrappers::SparsityPattern sparsity(locally_owned_dofs, MPI_COMM_WORLD);
+    TrilinosWrappers::SparsityPattern sparsity(locally_owned_dofs, mpi_comm);
     DoFTools::make_sparsity_pattern(dof_handler, sparsity);
     sparsity.compress();
 
@@ -76,18 +126,89 @@ HeatNonLinear::setup() {
     jacobian_matrix.reinit(sparsity);
 
     pcout << "  Initializing the system right-hand side" << std::endl;
-    residual_vector.reinit(locally_owned_dofs, MPI_COMM_WORLD);
+    residual_vector.reinit(locally_owned_dofs, mpi_comm);
     pcout << "  Initializing the solution vector" << std::endl;
-    solution_owned.reinit(locally_owned_dofs, MPI_COMM_WORLD);
-    delta_owned.reinit(locally_owned_dofs, MPI_COMM_WORLD);
+    solution_owned.reinit(locally_owned_dofs, mpi_comm);
+    delta_owned.reinit(locally_owned_dofs, mpi_comm);
+
+    solution.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_comm);
+    solution_old   = solution;
+    solution_older = solution;
+
+      if (mass_lumping) {
+        solution_old_owned.reinit(locally_owned_dofs, mpi_comm);
+        solution_older_owned.reinit(locally_owned_dofs, mpi_comm);
+        lumped_diagonal.reinit(locally_owned_dofs, mpi_comm);
+        lumped_tmp.reinit(locally_owned_dofs, mpi_comm);
+      }
+  }
+
+  // Split the locally owned cells into interior and boundary cells, and set
+  // up the ghost exchange of the solution.
+  {
+    owned_cells.clear();
+    std::vector<DoFHandler<dim>::active_cell_iterator> boundary_cells;
+    std::vector<types::global_dof_index>               dof_indices(fe->dofs_per_cell);
+
+      for (const auto &cell : dof_handler.active_cell_iterators()) {
+        if (!cell->is_locally_owned())
+          continue;
+
+        cell->get_dof_indices(dof_indices);
+        if (std::all_of(dof_indices.begin(), dof_indices.end(), [&](const auto &i) {
+              return locally_owned_dofs.is_element(i);
+            }))
+          owned_cells.push_back(cell);
+        else
+          boundary_cells.push_back(cell);
+      }
+
+    n_interior_cells = owned_cells.size();
+    owned_cells.insert(owned_cells.end(), boundary_cells.begin(), boundary_cells.end());
+
+    pcout << "  Interior cells = "
+          << Utilities::MPI::sum(n_interior_cells, mpi_comm) << " of "
+          << mesh.n_global_active_cells() << std::endl;
+
+    ghost_partitioner = std::make_shared<Utilities::MPI::Partitioner>(locally_owned_dofs,
+                                                                      locally_relevant_dofs,
+                                                                      mpi_comm);
+    ghost_import_buffer.resize(ghost_partitioner->n_import_indices());
+    ghost_values.resize(ghost_partitioner->n_ghost_indices());
 
-    solution.reinit(locally_owned_dofs, locally_relevant_dofs, MPI_COMM_WORLD);
-    solution_old = solution;
+    const Epetra_BlockMap &map = solution.trilinos_partitioner();
+
+    owned_local_indices.clear();
+    for (const auto i : locally_owned_dofs)
+      owned_local_indices.push_back(
+        map.LID(static_cast<TrilinosWrappers::types::int_type>(i)));
+
+    ghost_local_indices.clear();
+    for (const auto i : ghost_partitioner->ghost_indices())
+      ghost_local_indices.push_back(
+        map.LID(static_cast<TrilinosWrappers::types::int_type>(i)));
   }
+
+    if (!probe_points.empty()) {
+      pcout << "-----------------------------------------------" << std::endl;
+      setup_probes();
+    }
+
+  setup_output_triggers();
+
+#ifdef PRION_PERF_COUNTERS
+  perf_counters = std::make_unique<PerfCounters>(mpi_comm, flop_events);
+#endif
+
+  print_memory_report("after setup");
 }
 
 void
-HeatNonLinear::assemble_system() {
+HeatNonLinear::assemble_system(const bool &residual_only) {
+#ifdef PRION_PERF_COUNTERS
+  PerfCounters::Scope perf_scope(*perf_counters, PerfCounters::assembly);
+#endif
+
   const unsigned int dofs_per_cell = fe->dofs_per_cell;
   const unsigned int n_q           = quadrature->size();
 
@@ -101,20 +222,32 @@ HeatNonLinear::assemble_system() {
 
   std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
 
-  jacobian_matrix = 0.0;
+  if (!residual_only)
+    jacobian_matrix = 0.0;
   residual_vector = 0.0;
 
   // Value and gradient of the solution on current cell.
   std::vector<double>         solution_loc(n_q);
   std::vector<Tensor<1, dim>> solution_gradient_loc(n_q);
 
-  // Value of the solution at previous timestep (un) on current cell.
-  std::vector<double> solution_old_loc(n_q);
+  // Value and gradient of the solution at previous timestep (un) on current
+  // cell.
+  std::vector<double>         solution_old_loc(n_q);
+  std::vector<Tensor<1, dim>> solution_old_gradient_loc(n_q);
 
-    for (const auto &cell : dof_handler.active_cell_iterators()) {
-      if (!cell->is_locally_owned())
-        continue;
+  // Value of the solution two timesteps before (un-1) on current cell.
+  std::vector<double> solution_older_loc(n_q, 0.0);
+
+  const double a0 = time_coefficients[0];
+  const double a1 = time_coefficients[1];
+  const double a2 = time_coefficients[2];
 
+    for (unsigned int c = 0; c < owned_cells.size(); ++c) {
+      // The remaining cells need the ghost values of the solution.
+      if (c == n_interior_cells)
+        finish_ghost_update();
+
+      const auto &cell = owned_cells[c];
       fe_values.reinit(cell);
 
       cell_matrix   = 0.0;
@@ -124,29 +257,34 @@ HeatNonLinear::assemble_system() {
       fe_values.get_function_gradients(solution, solution_gradient_loc); // grad u n+1
       fe_values.get_function_values(solution_old, solution_old_loc);     // u n
 
+      if (a2 != 0.0)
+        fe_values.get_function_values(solution_older, solution_older_loc); // u n-1
+      if (theta_step != 1.0)
+        fe_values.get_function_gradients(solution_old, solution_old_gradient_loc);
+
         for (unsigned int q = 0; q < n_q; ++q) {
           // Evaluate coefficients on this quadrature node.
           const double alpha_loc = alpha.value(fe_values.quadrature_point(q));
 
             for (unsigned int i = 0; i < dofs_per_cell; ++i) {
-                for (unsigned int j = 0; j < dofs_per_cell; ++j) {
+                for (unsigned int j = 0; j < dofs_per_cell && !residual_only; ++j) {
                   // ------------------------------------------- (A.1)
                   // ------------------------------------------- // Mass matrix.
-                  cell_matrix(i, j) += fe_values.shape_value(i, q) *
+                  cell_matrix(i, j) += a0 * fe_values.shape_value(i, q) *
                                        fe_values.shape_value(j, q) / deltat *
                                        fe_values.JxW(q);
 
                   // ------------------------------------------- (A.2)
                   // ------------------------------------------- // Non-linear stiffness
                   // matrix, first term.
-                  cell_matrix(i, j) += fe_values.shape_grad(i, q) * D *
+                  cell_matrix(i, j) += theta_step * fe_values.shape_grad(i, q) * D *
                                        fe_values.shape_grad(j, q) * fe_values.JxW(q);
 
                   // ------------------------------------------- (A.3)
                   // ------------------------------------------- // Non-linear stiffness
                   // matrix, second term.
-                  cell_matrix(i, j) -= fe_values.shape_value(i, q) * alpha_loc *
-                                       (1 - 2 * solution_loc[q]) *
+                  cell_matrix(i, j) -= theta_step * fe_values.shape_value(i, q) *
+                                       alpha_loc * (1 - 2 * solution_loc[q]) *
                                        fe_values.shape_value(j, q) * fe_values.JxW(q);
                 }
 
@@ -155,29 +293,39 @@ HeatNonLinear::assemble_system() {
               // ------------------------------------------- (R.1)
               // ------------------------------------------- // Time derivative term.
               cell_residual(i) -= fe_values.shape_value(i, q) *
-                                  (solution_loc[q] - solution_old_loc[q]) / deltat *
-                                  fe_values.JxW(q);
+                                  (a0 * solution_loc[q] + a1 * solution_old_loc[q] +
+                                   a2 * solution_older_loc[q]) /
+                                  deltat * fe_values.JxW(q);
 
               // ------------------------------------------- (R.2)
               // ------------------------------------------- //
               cell_residual(i) -= fe_values.shape_grad(i, q) * D *
-                                  solution_gradient_loc[q] * fe_values.JxW(q);
+                                  (theta_step * solution_gradient_loc[q] +
+                                   (1.0 - theta_step) * solution_old_gradient_loc[q]) *
+                                  fe_values.JxW(q);
 
               // ------------------------------------------- (R.3)
               // ------------------------------------------- // Diffusion term.
-              cell_residual(i) += fe_values.shape_value(i, q) *
-                                  (alpha_loc * solution_loc[q] * (1 - solution_loc[q])) *
+              cell_residual(i) += fe_values.shape_value(i, q) * alpha_loc *
+                                  (theta_step * solution_loc[q] * (1 - solution_loc[q]) +
+                                   (1.0 - theta_step) * solution_old_loc[q] *
+                                     (1 - solution_old_loc[q])) *
                                   fe_values.JxW(q);
             }
         }
 
       cell->get_dof_indices(dof_indices);
 
-      jacobian_matrix.add(dof_indices, cell_matrix);
+      if (!residual_only)
+        jacobian_matrix.add(dof_indices, cell_matrix);
       residual_vector.add(dof_indices, cell_residual);
     }
 
-  jacobian_matrix.compress(VectorOperation::add);
+  // If all the cells are interior.
+  finish_ghost_update();
+
+  if (!residual_only)
+    jacobian_matrix.compress(VectorOperation::add);
   residual_vector.compress(VectorOperation::add);
 
   // We apply Dirichlet boundary conditions.
@@ -203,6 +351,63 @@ HeatNonLinear::assemble_system() {
   // }
 }
 
+void
+HeatNonLinear::start_ghost_update() {
+  finish_ghost_update();
+
+  // The locally owned values are copied in place, and only the ghost values
+  // are communicated.
+  double       *values  = solution.trilinos_vector()[0];
+  const double *u_owned = solution_owned.begin();
+  for (unsigned int k = 0; k < owned_local_indices.size(); ++k)
+    values[owned_local_indices[k]] = u_owned[k];
+
+  ghost_partitioner->export_to_ghosted_array_start<double>(
+    0,
+    ArrayView<const double>(u_owned, owned_local_indices.size()),
+    make_array_view(ghost_import_buffer),
+    make_array_view(ghost_values),
+    ghost_requests);
+  ghost_update_pending = true;
+}
+
+void
+HeatNonLinear::finish_ghost_update() {
+  if (!ghost_update_pending)
+    return;
+
+  ghost_partitioner->export_to_ghosted_array_finish<double>(make_array_view(ghost_values),
+                                                            ghost_requests);
+
+  double *values = solution.trilinos_vector()[0];
+  for (unsigned int k = 0; k < ghost_local_indices.size(); ++k)
+    values[ghost_local_indices[k]] = ghost_values[k];
+
+  ghost_update_pending = false;
+}
+
+void
+HeatNonLinear::update_time_coefficients() {
+  theta_step        = 1.0;
+  time_coefficients = {{1.0, -1.0, 0.0}};
+
+    if (time_scheme == TimeScheme::ExponentialEuler) {
+      // The Jacobian and residual are assembled without the time derivative:
+      // they are then -J and f(u_n), with J the Jacobian of f.
+      time_coefficients = {{0.0, 0.0, 0.0}};
+    } else if (time_scheme == TimeScheme::BDF2 && time_step > 1) {
+      // Variable step BDF2, with omega the ratio between the current and the
+      // previous step. For a constant step, the coefficients are 3/2, -2, 1/2.
+      const double omega = deltat / deltat_old;
+
+      time_coefficients = {{(1.0 + 2.0 * omega) / (1.0 + omega),
+                            -(1.0 + omega),
+                            omega * omega / (1.0 + omega)}};
+    } else if (time_scheme == TimeScheme::Theta) {
+      theta_step = theta;
+    }
+}
+
 // TODO CHOOSE THE BETTER PRECONDITIONER
 void
 HeatNonLinear::solve_linear_system() {
@@ -210,22 +415,65 @@ HeatNonLinear::solve_linear_system() {
 
   SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
   // SolverGMRES<TrilinosWrappers::MPI::Vector> solver(solver_control);
-  TrilinosWrappers::PreconditionSSOR preconditioner;
-  preconditioner.initialize(jacobian_matrix,
-                            TrilinosWrappers::PreconditionSSOR::AdditionalData(1.0));
+  Timer stopwatch;
+
+  // Solve with the given matrix and preconditioner, counting the hardware
+  // events of their products if enabled.
+  const auto solve_with = [&](const auto &A, const auto &P) {
+#ifdef PRION_PERF_COUNTERS
+    solver.solve(PerfCounters::Counted(A, *perf_counters, PerfCounters::spmv),
+                 delta_owned,
+                 residual_vector,
+                 PerfCounters::Counted(P, *perf_counters, PerfCounters::preconditioner));
+#else
+    solver.solve(A, delta_owned, residual_vector, P);
+#endif
+  };
+
+    if (mass_lumping) {
+      // The Jacobian differs from the constant lumped matrix only by a
+      // diagonal term, so that the preconditioner of the latter is reused.
+      solve_with(jacobian_matrix, lumped_preconditioner);
+    } else {
+      std::unique_ptr<TrilinosWrappers::PreconditionBase> P;
+
+        if (preconditioner == Preconditioner::SSOR) {
+          auto ssor = std::make_unique<TrilinosWrappers::PreconditionSSOR>();
+          ssor->initialize(jacobian_matrix,
+                           TrilinosWrappers::PreconditionSSOR::AdditionalData(1.0));
+          P = std::move(ssor);
+        } else if (preconditioner == Preconditioner::Jacobi) {
+          auto jacobi = std::make_unique<TrilinosWrappers::PreconditionJacobi>();
+          jacobi->initialize(jacobian_matrix);
+          P = std::move(jacobi);
+        } else {
+          auto amg = std::make_unique<TrilinosWrappers::PreconditionAMG>();
+          amg->initialize(jacobian_matrix);
+          P = std::move(amg);
+        }
+      linear_stats.preconditioner_time = stopwatch.wall_time();
+
+      stopwatch.restart();
+      solve_with(jacobian_matrix, *P);
+    }
+
+  linear_stats.linear_solve_time = stopwatch.wall_time();
+  linear_stats.linear_iterations = solver_control.last_step();
 
-  solver.solve(jacobian_matrix, delta_owned, residual_vector, preconditioner);
   pcout << "  " << solver_control.last_step() << " CG iterations" << std::endl;
   // pcout << "  " << solver_control.last_step() << " GMRES iterations" << std::endl;
 }
 
-void
+bool
 HeatNonLinear::solve_newton() {
-  const unsigned int n_max_iters        = 1000;
+  const unsigned int n_max_iters = adaptive.enabled ? adaptive.max_newton_iterations : 1000;
   const double       residual_tolerance = 1e-10;
 
   unsigned int n_iter        = 0;
   double       residual_norm = residual_tolerance + 1;
+  bool         updated       = false;
+
+  step_stats = SolverStats();
 
   // We apply the boundary conditions to the initial guess (which is stored in
   // solution_owned and solution).
@@ -234,10 +482,24 @@ HeatNonLinear::solve_newton() {
   }
 
     while (n_iter < n_max_iters && residual_norm > residual_tolerance) {
+      Timer iteration_watch;
+      Timer stopwatch;
+
+      linear_stats = SolverStats();
+
       timer.enter_subsection("Assemble system");
-      assemble_system();
+      if (mass_lumping)
+        assemble_system_lumped();
+      else
+        assemble_system();
       timer.leave_subsection();
-      residual_norm = residual_vector.l2_norm();
+      linear_stats.assemble_time = stopwatch.wall_time();
+
+      residual_norm              = residual_vector.l2_norm();
+      linear_stats.residual_norm = residual_norm;
+
+      if (!std::isfinite(residual_norm))
+        break;
 
       pcout << "  Newton iteration " << n_iter << "/" << n_max_iters
             << " - ||r|| = " << std::scientific << std::setprecision(6) << residual_norm
@@ -246,93 +508,1578 @@ HeatNonLinear::solve_newton() {
         // We actually solve the system only if the residual is larger than the
         // tolerance.
         if (residual_norm > residual_tolerance) {
+          // For large time steps, the Jacobian may be indefinite where u is
+          // small, and CG may fail. With adaptive time stepping, this is
+          // treated as a failed Newton solve, so that the step is retried with
+          // a smaller time step.
+          bool solved = true;
+
           timer.enter_subsection("Solve system");
-          solve_linear_system();
+          try {
+            solve_linear_system();
+          } catch (const SolverControl::NoConvergence &) {
+              if (!adaptive.enabled) {
+                timer.leave_subsection();
+                throw;
+              }
+            solved = false;
+          }
           timer.leave_subsection();
 
+            if (!solved) {
+              pcout << " - the linear solver did not converge" << std::endl;
+              break;
+            }
+
           solution_owned += delta_owned;
-          solution = solution_owned;
+          updated = true;
+
+            // The ghost values arrive while the next assembly processes the
+            // interior cells. The lumped assembly only uses locally owned
+            // values, so that the exchange is made once, after the iterations.
+            if (!mass_lumping) {
+              stopwatch.restart();
+              start_ghost_update();
+              linear_stats.ghost_update_time = stopwatch.wall_time();
+            }
         } else {
           pcout << " < tolerance" << std::endl;
         }
 
+      write_telemetry("newton",
+                      time_step,
+                      n_iter,
+                      linear_stats,
+                      iteration_watch.wall_time(),
+                      deltat);
+
+      step_stats.residual_norm = residual_norm;
+      step_stats.linear_iterations += linear_stats.linear_iterations;
+      step_stats.assemble_time += linear_stats.assemble_time;
+      step_stats.preconditioner_time += linear_stats.preconditioner_time;
+      step_stats.linear_solve_time += linear_stats.linear_solve_time;
+      step_stats.ghost_update_time += linear_stats.ghost_update_time;
+
       ++n_iter;
     }
+
+  // The solution is complete before it is used outside of the iterations.
+    if (mass_lumping && updated) {
+      Timer stopwatch;
+      start_ghost_update();
+      finish_ghost_update();
+      step_stats.ghost_update_time += stopwatch.wall_time();
+    } else {
+      finish_ghost_update();
+    }
+
+  step_stats.newton_iterations = n_iter;
+
+  return residual_norm <= residual_tolerance;
 }
 
 void
-HeatNonLinear::output(const unsigned int &time_step, const double &time) const {
-  DataOut<dim> data_out;
-  data_out.add_data_vector(dof_handler, solution, "u");
+HeatNonLinear::assemble_constant_matrices() {
+  if (alpha_owned.size() > 0)
+    return;
+
+  pcout << "  Assembling the mass and stiffness matrices" << std::endl;
+
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q           = quadrature->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients | update_JxW_values);
+
+  FullMatrix<double> cell_mass_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_stiffness_matrix(dofs_per_cell, dofs_per_cell);
 
-  // std::vector<unsigned int> partition_int(mesh.n_active_cells());
-  // GridTools::get_subdomain_association(mesh, partition_int);
-  // const Vector<double> partitioning(partition_int.begin(), partition_int.end());
-  // data_out.add_data_vector(partitioning, "partitioning");
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
 
-  data_out.build_patches();
+  // The matrices share the sparsity pattern of the Jacobian.
+  mass_matrix.reinit(jacobian_matrix);
+  stiffness_matrix.reinit(jacobian_matrix);
+  mass_matrix      = 0.0;
+  stiffness_matrix = 0.0;
 
-  std::string output_file_name = std::to_string(time_step);
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
 
-  // Pad with zeros.
-  output_file_name =
-    "output-" + std::string(4 - output_file_name.size(), '0') + output_file_name;
+      fe_values.reinit(cell);
 
-  DataOutBase::DataOutFilter data_filter(
-    DataOutBase::DataOutFilterFlags(/*filter_duplicate_vertices = */ false,
-                                    /*xdmf_hdf5_output = */ true));
-  data_out.write_filtered_data(data_filter);
-  data_out.write_hdf5_parallel(data_filter, "/scratch/hpc/par1/out/" + output_file_name + ".h5", MPI_COMM_WORLD);
+      cell_mass_matrix      = 0.0;
+      cell_stiffness_matrix = 0.0;
 
-  std::vector<XDMFEntry> xdmf_entries({data_out.create_xdmf_entry(
-    data_filter, output_file_name + ".h5", time, MPI_COMM_WORLD)});
-  data_out.write_xdmf_file(xdmf_entries, "/scratch/hpc/par1/out/" + output_file_name + ".xdmf", MPI_COMM_WORLD);
+        for (unsigned int q = 0; q < n_q; ++q) {
+            for (unsigned int i = 0; i < dofs_per_cell; ++i) {
+                for (unsigned int j = 0; j < dofs_per_cell; ++j) {
+                  cell_mass_matrix(i, j) += fe_values.shape_value(i, q) *
+                                            fe_values.shape_value(j, q) * fe_values.JxW(q);
+
+                  cell_stiffness_matrix(i, j) += fe_values.shape_grad(i, q) * D *
+                                                 fe_values.shape_grad(j, q) *
+                                                 fe_values.JxW(q);
+                }
+            }
+        }
+
+      cell->get_dof_indices(dof_indices);
+
+      mass_matrix.add(dof_indices, cell_mass_matrix);
+      stiffness_matrix.add(dof_indices, cell_stiffness_matrix);
+    }
+
+  mass_matrix.compress(VectorOperation::add);
+  stiffness_matrix.compress(VectorOperation::add);
+
+  alpha_owned.reinit(locally_owned_dofs, mpi_comm);
+  VectorTools::interpolate(dof_handler, alpha, alpha_owned);
+
+  // The lumped mass matrix has the row sums of the mass matrix on its diagonal.
+  TrilinosWrappers::MPI::Vector ones(locally_owned_dofs, mpi_comm);
+  ones = 1.0;
+  lumped_mass.reinit(locally_owned_dofs, mpi_comm);
+  mass_matrix.vmult(lumped_mass, ones);
+
+  inverse_lumped_mass = lumped_mass;
+  for (auto &m : inverse_lumped_mass)
+    m = 1.0 / m;
 }
 
 void
-HeatNonLinear::solve() {
-  pcout << "===============================================" << std::endl;
+HeatNonLinear::assemble_system_lumped() {
+#ifdef PRION_PERF_COUNTERS
+  PerfCounters::Scope perf_scope(*perf_counters, PerfCounters::assembly);
+#endif
+
+  assemble_constant_matrices();
+
+  const double a0 = time_coefficients[0];
+  const double a1 = time_coefficients[1];
+  const double a2 = time_coefficients[2];
+
+  // The constant part of the Jacobian, a0 / deltat M_L + theta K, and its
+  // preconditioner are rebuilt only when the coefficients change.
+    if (lumped_matrix_coefficients[0] != a0 / deltat ||
+        lumped_matrix_coefficients[1] != theta_step) {
+      lumped_matrix.copy_from(stiffness_matrix);
+      lumped_matrix *= theta_step;
+
+      const double *m_loc = lumped_mass.begin();
+      unsigned int  k     = 0;
+      for (const auto i : locally_owned_dofs)
+        lumped_matrix.add(i, i, a0 / deltat * m_loc[k++]);
+      lumped_matrix.compress(VectorOperation::add);
+
+      // The Jacobian differs from this matrix only on its diagonal, which is
+      // rewritten at every iteration.
+      jacobian_matrix.copy_from(lumped_matrix);
+
+      double *d_loc = lumped_diagonal.begin();
+      k             = 0;
+      for (const auto i : locally_owned_dofs)
+        d_loc[k++] = lumped_matrix.diag_element(i);
+
+        // No linear system is solved without the time derivative (i.e. by the
+        // exponential integrator).
+        if (a0 != 0.0) {
+          Timer stopwatch;
+          TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+          amg_data.elliptic              = true;
+          amg_data.higher_order_elements = (r > 1);
+          lumped_preconditioner.initialize(lumped_matrix, amg_data);
+          linear_stats.preconditioner_time = stopwatch.wall_time();
+        }
 
-  time = 0.0;
+      lumped_matrix_coefficients = {{a0 / deltat, theta_step}};
+    }
 
-  // Apply the initial condition.
-  {
-    pcout << "Applying the initial condition" << std::endl;
+  // Diffusion terms (R.2). The owned copies of the old solutions are updated
+  // once per time step, in advance().
+  stiffness_matrix.vmult(residual_vector, solution_owned);
+  residual_vector *= -theta_step;
 
-    VectorTools::interpolate(dof_handler, u_0, solution_owned);
-    solution = solution_owned;
+    if (theta_step != 1.0) {
+      stiffness_matrix.vmult(lumped_tmp, solution_old_owned);
+      residual_vector.add(-(1.0 - theta_step), lumped_tmp);
+    }
 
-    // Output the initial solution.
-    timer.enter_subsection("Writing");
-    output(0, 0.0);
-    timer.leave_subsection();
-    pcout << "-----------------------------------------------" << std::endl;
+  // Time derivative (R.1) and reaction (R.3) terms are diagonal, and evaluated
+  // at the nodes. The Jacobian is the constant matrix plus the diagonal
+  // derivative of the reaction term (A.3), on the diagonal. Local values, in
+  // the order of locally_owned_dofs:
+  const double *d_loc       = lumped_diagonal.begin();
+  const double *m_loc       = lumped_mass.begin();
+  const double *alpha_loc   = alpha_owned.begin();
+  const double *u_loc       = solution_owned.begin();
+  const double *u_old_loc   = solution_old_owned.begin();
+  const double *u_older_loc = solution_older_owned.begin();
+  double       *r_loc       = residual_vector.begin();
+
+  unsigned int k = 0;
+    for (const auto i : locally_owned_dofs) {
+      const double u     = u_loc[k];
+      const double u_old = u_old_loc[k];
+
+      r_loc[k] += m_loc[k] * (-(a0 * u + a1 * u_old + a2 * u_older_loc[k]) / deltat +
+                              alpha_loc[k] * (theta_step * u * (1 - u) +
+                                              (1.0 - theta_step) * u_old * (1 - u_old)));
+
+      jacobian_matrix.set(
+        i, i, d_loc[k] - theta_step * m_loc[k] * alpha_loc[k] * (1 - 2 * u));
+
+      ++k;
+    }
+
+  jacobian_matrix.compress(VectorOperation::insert);
+}
+
+void
+HeatNonLinear::update_diffusion_matrix() {
+  assemble_constant_matrices();
+
+  if (diffusion_deltat == deltat)
+    return;
+
+  Timer stopwatch;
+
+  diffusion_matrix.copy_from(mass_matrix);
+  diffusion_matrix *= 1.0 / deltat;
+  diffusion_matrix.add(1.0, stiffness_matrix);
+  linear_stats.assemble_time = stopwatch.wall_time();
+
+  // The matrix is symmetric positive definite and constant, so that the setup
+  // of an algebraic multigrid preconditioner pays off.
+  stopwatch.restart();
+  TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+  amg_data.elliptic              = true;
+  amg_data.higher_order_elements = (r > 1);
+  diffusion_preconditioner.initialize(diffusion_matrix, amg_data);
+  linear_stats.preconditioner_time = stopwatch.wall_time();
+
+  diffusion_deltat = deltat;
+}
+
+void
+HeatNonLinear::apply_reaction(const double &tau) {
+  auto alpha_it = alpha_owned.begin();
+
+    for (auto u_it = solution_owned.begin(); u_it != solution_owned.end();
+         ++u_it, ++alpha_it) {
+      // u(tau) = u0 e^(alpha tau) / (1 - u0 + u0 e^(alpha tau)).
+      const double growth = std::expm1(*alpha_it * tau);
+      *u_it               = *u_it * (1.0 + growth) / (1.0 + *u_it * growth);
+    }
+}
+
+void
+HeatNonLinear::solve_splitting() {
+  Timer step_watch;
+  Timer stopwatch;
+
+  linear_stats = SolverStats();
+
+  update_diffusion_matrix();
+
+  // The initial guess may be an extrapolation: restart from u_n.
+  solution_owned = solution_old;
+
+  apply_reaction(0.5 * deltat);
+
+  // Diffusion step: (M / deltat + K) u = M / deltat u_reaction.
+  mass_matrix.vmult(residual_vector, solution_owned);
+  residual_vector /= deltat;
+
+  stopwatch.restart();
+  SolverControl solver_control(1000, 1e-8 * residual_vector.l2_norm());
+  SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
+
+  timer.enter_subsection("Solve system");
+  solver.solve(diffusion_matrix, solution_owned, residual_vector, diffusion_preconditioner);
+  timer.leave_subsection();
+  linear_stats.linear_solve_time = stopwatch.wall_time();
+  linear_stats.linear_iterations = solver_control.last_step();
+
+  pcout << "  " << solver_control.last_step() << " CG iterations" << std::endl;
+
+  apply_reaction(0.5 * deltat);
+
+  stopwatch.restart();
+  solution = solution_owned;
+  linear_stats.ghost_update_time = stopwatch.wall_time();
+
+  step_stats = linear_stats;
+  write_telemetry(
+    "splitting", time_step, 0, linear_stats, step_watch.wall_time(), deltat);
+}
+
+namespace {
+  // Exponential of a small dense matrix, computed by scaling and squaring of
+  // its Taylor series.
+  FullMatrix<double>
+  matrix_exponential(const FullMatrix<double> &A) {
+    const unsigned int n    = A.m();
+    const double       norm = A.linfty_norm();
+
+    // Scale the matrix so that its norm is at most 1/2.
+    const unsigned int n_squarings =
+      norm > 0.5 ? static_cast<unsigned int>(std::ceil(std::log2(norm / 0.5))) : 0;
+
+    FullMatrix<double> scaled(A);
+    scaled *= std::pow(0.5, n_squarings);
+
+    FullMatrix<double> result(n, n);
+    FullMatrix<double> term(n, n);
+    FullMatrix<double> tmp(n, n);
+
+    result = IdentityMatrix(n);
+    term   = IdentityMatrix(n);
+
+      for (unsigned int k = 1; k <= 16; ++k) {
+        term.mmult(tmp, scaled);
+        tmp *= 1.0 / k;
+        term = tmp;
+        result.add(1.0, term);
+      }
+
+      for (unsigned int k = 0; k < n_squarings; ++k) {
+        result.mmult(tmp, result);
+        result = tmp;
+      }
+
+    return result;
   }
+} // namespace
+
+void
+HeatNonLinear::solve_exponential() {
+  Timer step_watch;
+  Timer stopwatch;
+
+  linear_stats = SolverStats();
+
+  assemble_constant_matrices();
+
+  // Linearize at u_n: jacobian_matrix = -J and residual_vector = f(u_n), both
+  // multiplied by the mass matrix.
+  solution_owned = solution_old;
+  solution       = solution_old;
+
+  timer.enter_subsection("Assemble system");
+  if (mass_lumping)
+    assemble_system_lumped();
+  else
+    assemble_system();
+  timer.leave_subsection();
+  linear_stats.assemble_time = stopwatch.wall_time();
+  linear_stats.residual_norm = residual_vector.l2_norm();
+
+  stopwatch.restart();
+  timer.enter_subsection("Solve system");
+
+  // The increment v = u - u_n solves the linear problem v' = A v + b,
+  // v(0) = 0, with A = -M^{-1} jacobian_matrix and b = M^{-1} residual_vector.
+  // It is advanced by substeps tau as
+  //   v <- v + tau phi_1(tau A) (A v + b),
+  // and phi_1(tau A) c is approximated by beta V phi_1(tau H) e_1, with V and H
+  // from the Arnoldi process started from c = beta V e_1.
+  TrilinosWrappers::PreconditionJacobi mass_preconditioner;
+  mass_preconditioner.initialize(mass_matrix);
+
+  TrilinosWrappers::MPI::Vector tmp(locally_owned_dofs, mpi_comm);
+
+  // The mass matrix is well conditioned, and its inverse is applied with a
+  // tight tolerance so that the Arnoldi process is not perturbed. With mass
+  // lumping, the inverse is diagonal.
+  const auto apply_inverse_mass = [&](TrilinosWrappers::MPI::Vector       &dst,
+                                      const TrilinosWrappers::MPI::Vector &src) {
+      if (mass_lumping) {
+        dst = src;
+        dst.scale(inverse_lumped_mass);
+        return;
+      }
+
+    SolverControl                           solver_control(1000, 1e-12 * src.l2_norm());
+    SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
+
+    dst = 0.0;
+    solver.solve(mass_matrix, dst, src, mass_preconditioner);
+  };
+
+  const auto apply_operator = [&](TrilinosWrappers::MPI::Vector       &dst,
+                                  const TrilinosWrappers::MPI::Vector &src) {
+    jacobian_matrix.vmult(tmp, src);
+    tmp *= -1.0;
+    apply_inverse_mass(dst, tmp);
+    ++linear_stats.linear_iterations;
+  };
+
+  TrilinosWrappers::MPI::Vector b(locally_owned_dofs, mpi_comm);
+  apply_inverse_mass(b, residual_vector);
+
+  TrilinosWrappers::MPI::Vector increment(locally_owned_dofs, mpi_comm);
+  TrilinosWrappers::MPI::Vector c(locally_owned_dofs, mpi_comm);
+
+  krylov_basis.resize(krylov_max_dimension + 1);
+  for (auto &v : krylov_basis)
+    if (v.size() == 0)
+      v.reinit(locally_owned_dofs, mpi_comm);
+
+  double       s          = 0.0;
+  double       tau        = deltat;
+  unsigned int n_substeps = 0;
+
+    while (s < deltat * (1.0 - 1e-12)) {
+      tau = std::min(tau, deltat - s);
+
+      // c = A v + b (and v = 0 on the first substep).
+        if (n_substeps == 0) {
+          c = b;
+        } else {
+          apply_operator(c, increment);
+          c += b;
+        }
+
+      const double beta = c.l2_norm();
+      if (beta == 0.0)
+        break;
+
+      krylov_basis[0].equ(1.0 / beta, c);
+
+      // Hessenberg matrix of the Arnoldi process.
+      FullMatrix<double> H(krylov_max_dimension + 1, krylov_max_dimension);
+
+      // phi_1(tau H_m) e_1, and the dimension m of the subspace.
+      Vector<double> phi_e1;
+      unsigned int   m = 0;
+
+      // Compute phi_1(tau H_m) e_1 from the exponential of the augmented
+      // matrix [tau H_m, e_1; 0, 0], and estimate the error of the Krylov
+      // approximation of tau phi_1(tau A) c, relative to beta.
+      const auto evaluate_phi = [&](const unsigned int &m_, const bool &breakdown) {
+        FullMatrix<double> augmented(m_ + 1, m_ + 1);
+        for (unsigned int i = 0; i < m_; ++i)
+          for (unsigned int j = 0; j < m_; ++j)
+            augmented(i, j) = tau * H(i, j);
+        augmented(0, m_) = 1.0;
+
+        const FullMatrix<double> exponential = matrix_exponential(augmented);
+
+        phi_e1.reinit(m_);
+        for (unsigned int i = 0; i < m_; ++i)
+          phi_e1[i] = exponential(i, m_);
 
-  unsigned int time_step = 0;
-  unsigned int tt = 1;
+        return breakdown ? 0.0 : tau * H(m_, m_ - 1) * std::abs(phi_e1[m_ - 1]);
+      };
+
+      double error = 0.0;
+
+        for (m = 1; m <= krylov_max_dimension; ++m) {
+          TrilinosWrappers::MPI::Vector &w = krylov_basis[m];
+          apply_operator(w, krylov_basis[m - 1]);
+
+            // Modified Gram-Schmidt orthogonalization.
+            for (unsigned int i = 0; i < m; ++i) {
+              H(i, m - 1) = krylov_basis[i] * w;
+              w.add(-H(i, m - 1), krylov_basis[i]);
+            }
+
+          H(m, m - 1)          = w.l2_norm();
+          const bool breakdown = H(m, m - 1) < 1e-12 * beta;
+
+          error = evaluate_phi(m, breakdown);
+          if (breakdown || error <= krylov_tolerance)
+            break;
+
+          w /= H(m, m - 1);
+        }
 
-    while (time < T - 0.5 * deltat) {
+      m = std::min(m, krylov_max_dimension);
+
+        // If the subspace is not large enough, reduce the substep.
+        while (error > krylov_tolerance) {
+          tau *= 0.5;
+          error = evaluate_phi(m, false);
+        }
+
+      for (unsigned int i = 0; i < m; ++i)
+        increment.add(tau * beta * phi_e1[i], krylov_basis[i]);
+
+      s += tau;
+      ++n_substeps;
+    }
+
+  solution_owned = solution_old;
+  solution_owned += increment;
+
+  timer.leave_subsection();
+  linear_stats.linear_solve_time = stopwatch.wall_time();
+
+  stopwatch.restart();
+  solution = solution_owned;
+  linear_stats.ghost_update_time = stopwatch.wall_time();
+
+  pcout << "  " << linear_stats.linear_iterations << " operator applications, "
+        << n_substeps << " substeps" << std::endl;
+
+  step_stats = linear_stats;
+  write_telemetry("exponential",
+                  time_step,
+                  n_substeps,
+                  linear_stats,
+                  step_watch.wall_time(),
+                  deltat);
+}
+
+void
+HeatNonLinear::solve_time_step() {
+    if (!adaptive.enabled) {
+      // Do not step past the final time: if the interval is not a multiple of
+      // the time step, the last step is shortened, and the time step is
+      // restored afterwards.
+      const double deltat_nominal = deltat;
+      deltat                      = std::min(deltat, time_end - time);
       time += deltat;
+
+      pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
+            << std::fixed << time << std::endl;
+
+      update_time_coefficients();
+
+      if (time_scheme == TimeScheme::StrangSplitting)
+        solve_splitting();
+      else if (time_scheme == TimeScheme::ExponentialEuler)
+        solve_exponential();
+      else
+        solve_newton();
+
+      deltat = deltat_nominal;
+      return;
+    }
+
+  const double time_old = time;
+
+    while (true) {
+      // Do not step past the final time.
+      deltat = std::min(deltat, time_end - time_old);
+      time   = time_old + deltat;
+
+      pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
+            << std::fixed << time << ", dt = " << std::scientific << std::setprecision(3)
+            << deltat << std::fixed << std::endl;
+
+      // The error estimate compares the backward Euler solution with the linear
+      // extrapolation of the two previous steps, which is also used as the
+      // initial guess for Newton's method. On the first step only the old
+      // solution is available, and no estimate can be computed.
+      const bool has_history = time_step > 1;
+
+      TrilinosWrappers::MPI::Vector predictor(locally_owned_dofs, mpi_comm);
+      predictor = solution_old;
+
+        if (has_history) {
+          TrilinosWrappers::MPI::Vector older_owned(locally_owned_dofs, mpi_comm);
+          older_owned = solution_older;
+
+          const double ratio = deltat / deltat_old;
+          predictor.sadd(1.0 + ratio, -ratio, older_owned);
+        }
+
+      solution_owned = predictor;
+      solution       = solution_owned;
+
+      update_time_coefficients();
+
+      bool converged = true;
+      if (time_scheme == TimeScheme::StrangSplitting)
+        solve_splitting();
+      else if (time_scheme == TimeScheme::ExponentialEuler)
+        solve_exponential();
+      else
+        converged = solve_newton();
+
+      double factor = 1.0;
+      double error  = 0.0;
+
+        if (!converged) {
+          AssertThrow(deltat > adaptive.min_deltat,
+                      ExcMessage("Newton's method did not converge with the minimum "
+                                 "time step."));
+          factor = 0.5;
+        } else if (has_history) {
+          // With u_pred the linear extrapolation, the local truncation error of
+          // backward Euler is dt / (2 dt + dt_old) * (u_{n+1} - u_pred).
+          predictor.sadd(-1.0, 1.0, solution_owned);
+          error = deltat / (2.0 * deltat + deltat_old) * predictor.linfty_norm() /
+                  adaptive.tolerance;
+
+          // Backward Euler is first order, so the error scales with dt^2. For
+          // the second order schemes, the same estimate is used: it bounds
+          // their error from above, and the step selection is conservative.
+          factor = std::clamp(0.9 / std::sqrt(std::max(error, 1e-10)), 0.2, 2.0);
+
+          if (step_stats.newton_iterations > adaptive.target_newton_iterations)
+            factor = std::min(factor, 1.0);
+        }
+
+      const bool accepted = converged && (error <= 1.0 || deltat <= adaptive.min_deltat);
+      const double deltat_new =
+        std::clamp(deltat * factor, adaptive.min_deltat, adaptive.max_deltat);
+
+        if (accepted) {
+          if (error > 1.0)
+            pcout << "  Accepting the step with the minimum time step, estimated "
+                  << "error / tolerance = " << error << std::endl;
+
+          deltat_old = deltat;
+          deltat     = deltat_new;
+          return;
+        }
+
+      if (converged)
+        pcout << "  Step rejected, estimated error / tolerance = " << error;
+      else
+        pcout << "  Step rejected, Newton's method did not converge";
+      pcout << "; retrying with dt = " << std::scientific << deltat_new << std::fixed
+            << std::endl;
+
+      deltat         = deltat_new;
+      solution_owned = solution_old;
+      solution       = solution_old;
+    }
+}
+
+void
+HeatNonLinear::output(const unsigned int                  &time_step,
+                      const double                        &time,
+                      const TrilinosWrappers::MPI::Vector &u) {
+  // The output mesh is made of the DoFs, so that each output only writes the
+  // locally owned values of u, without duplicates: every process gives the
+  // support points of its locally owned DoFs, and the cells it owns, as the
+  // global indices of their vertex DoFs. This relies on the DoFs of each
+  // process being contiguous, and numbered in the order of the processes.
+    if (!writer) {
+      writer =
+        std::make_unique<SolutionWriter>(mpi_comm, output_directory, asynchronous_output);
+      writer->set_compression(output_compression, output_tolerance);
+
+      // After a restart, the time series is continued from the checkpoint.
+      if (!restart_directory.empty())
+        writer->set_restart(tt);
+
+      const std::uint64_t n_owned     = locally_owned_dofs.n_elements();
+      std::uint64_t       first_owned = 0;
+      MPI_Exscan(&n_owned, &first_owned, 1, MPI_UINT64_T, MPI_SUM, mpi_comm);
+      if (mpi_rank == 0)
+        first_owned = 0;
+
+      AssertThrow(locally_owned_dofs.is_contiguous() &&
+                    (n_owned == 0 || locally_owned_dofs.nth_index_in_set(0) == first_owned),
+                  ExcMessage("The DoFs of each process must be contiguous, and numbered "
+                             "in the order of the processes."));
+
+      const auto &unit_support_points = fe->get_unit_support_points();
+
+      std::vector<double>                  nodes(dim * n_owned);
+      std::vector<unsigned int>            cells;
+      std::vector<types::global_dof_index> dof_indices(fe->dofs_per_cell);
+      unsigned int                         n_vertices = 0;
+
+        for (const auto &cell : owned_cells) {
+          cell->get_dof_indices(dof_indices);
+          n_vertices = cell->n_vertices();
+
+          // The vertex DoFs come first, one per vertex.
+          for (unsigned int v = 0; v < n_vertices; ++v)
+            cells.push_back(dof_indices[v]);
+
+            // Support points, given that the cells are straight-sided
+            // simplices: x = v_0 + J xi, with the edges from v_0 as columns of
+            // J.
+            for (unsigned int i = 0; i < fe->dofs_per_cell; ++i) {
+              if (!locally_owned_dofs.is_element(dof_indices[i]))
+                continue;
+
+              Point<dim> x = cell->vertex(0);
+              for (unsigned int k = 0; k < dim; ++k)
+                x += unit_support_points[i][k] * (cell->vertex(k + 1) - cell->vertex(0));
+
+              const auto n = locally_owned_dofs.index_within_set(dof_indices[i]);
+              for (unsigned int d = 0; d < dim; ++d)
+                nodes[dim * n + d] = x[d];
+            }
+        }
+
+      writer->set_mesh(nodes, cells, n_vertices);
+    }
+
+  // Locally owned values, in the order of the DoFs.
+  std::vector<double> values;
+  values.reserve(locally_owned_dofs.n_elements());
+  for (const auto i : locally_owned_dofs)
+    values.push_back(u[i]);
+
+  writer->write(values, time_step, time);
+}
+
+bool
+HeatNonLinear::output_enabled() const {
+  return output_frequency > 0 || output_interval > 0.0 || !output_times.empty() ||
+         !output_triggers.empty();
+}
+
+double
+HeatNonLinear::next_output_time(const double &t) const {
+  // Tolerance for times that are equal up to roundoff.
+  const double tolerance = 1e-9 * std::max(1.0, T);
+
+  double result = std::numeric_limits<double>::infinity();
+
+  if (output_interval > 0.0)
+    result = output_interval * (std::floor((t + tolerance) / output_interval) + 1.0);
+
+  const auto next =
+    std::upper_bound(output_times.begin(), output_times.end(), t + tolerance);
+  if (next != output_times.end())
+    result = std::min(result, *next);
+
+  return result;
+}
+
+void
+HeatNonLinear::setup_output_triggers() {
+    for (auto &trigger : output_triggers) {
+      trigger.dofs.clear();
+
+        for (const auto &cell : dof_handler.active_cell_iterators()) {
+          if (!cell->is_locally_owned())
+            continue;
+
+            for (const unsigned int v : cell->vertex_indices()) {
+              const types::global_dof_index dof = cell->vertex_dof_index(v, 0);
+              if (locally_owned_dofs.is_element(dof) &&
+                  cell->vertex(v).distance(trigger.center) <= trigger.radius)
+                trigger.dofs.push_back(dof);
+            }
+        }
+
+      std::sort(trigger.dofs.begin(), trigger.dofs.end());
+      trigger.dofs.erase(std::unique(trigger.dofs.begin(), trigger.dofs.end()),
+                         trigger.dofs.end());
+
+      const unsigned int n_vertices = Utilities::MPI::sum(trigger.dofs.size(), mpi_comm);
+      AssertThrow(n_vertices > 0,
+                  ExcMessage("The region of an output trigger contains no vertices."));
+    }
+}
+
+bool
+HeatNonLinear::check_output_triggers() {
+  if (output_triggers.empty())
+    return false;
+
+  // Maximum of u in the region of each trigger, reduced with one call.
+  std::vector<double> max_u(output_triggers.size(), std::numeric_limits<double>::lowest());
+  for (unsigned int k = 0; k < output_triggers.size(); ++k)
+    for (const auto &dof : output_triggers[k].dofs)
+      max_u[k] = std::max<double>(max_u[k], solution_owned[dof]);
+
+  Utilities::MPI::max(max_u, mpi_comm, max_u);
+
+  bool fired = false;
+
+    for (unsigned int k = 0; k < output_triggers.size(); ++k) {
+        if (!output_triggers[k].fired && max_u[k] > output_triggers[k].threshold) {
+          output_triggers[k].fired = true;
+          fired                    = true;
+
+          pcout << "  Output trigger " << k << " fired (max u in the region = "
+                << std::scientific << max_u[k] << ")" << std::endl;
+        }
+    }
+
+  return fired;
+}
+
+void
+HeatNonLinear::write_outputs(const double &time_start, const bool &stop) {
+  // Whether the current solution has been written.
+  bool written = false;
+
+  // Scheduled outputs within the step, interpolated between the solutions at
+  // its endpoints.
+    for (double t = next_output_time(last_output_time);
+         t <= time + 1e-9 * std::max(1.0, T);
+         t = next_output_time(t)) {
+      const double weight = std::min((t - time_start) / (time - time_start), 1.0);
+
+      timer.enter_subsection("Writing");
+        if (weight > 1.0 - 1e-9) {
+          output(tt, time, solution);
+          written = true;
+        } else {
+          TrilinosWrappers::MPI::Vector interpolated_owned(locally_owned_dofs, mpi_comm);
+          interpolated_owned = solution_old;
+          interpolated_owned.sadd(1.0 - weight, weight, solution_owned);
+
+          TrilinosWrappers::MPI::Vector interpolated(locally_owned_dofs,
+                                                     locally_relevant_dofs,
+                                                     mpi_comm);
+          interpolated = interpolated_owned;
+
+          output(tt, t, interpolated);
+        }
+      timer.leave_subsection();
+
+      tt++;
+      last_output_time = t;
+    }
+
+  // Triggers are checked at every step, also if the solution has been written.
+  const bool triggered = check_output_triggers();
+
+  // If we stop early, the final state is always written.
+  const bool write_current = (output_frequency > 0 && !(time_step % output_frequency)) ||
+                             triggered || (stop && output_enabled());
+
+    if (write_current && !written) {
+      timer.enter_subsection("Writing");
+      output(tt, time, solution);
+      timer.leave_subsection();
+      tt++;
+    }
+}
+
+void
+HeatNonLinear::write_checkpoint() {
+  timer.enter_subsection("Checkpoint");
+
+  // Local values of the current and previous solutions: the older one is not
+  // needed, since it is overwritten by the previous one at the next step.
+  const auto local_values = [this](const TrilinosWrappers::MPI::Vector &u) {
+    TrilinosWrappers::MPI::Vector u_owned(locally_owned_dofs, mpi_comm);
+    u_owned = u;
+    return std::vector<double>(u_owned.begin(), u_owned.end());
+  };
+
+  // A restart from this checkpoint keeps the outputs written so far, which
+  // must then be complete in the output file.
+  if (writer)
+    writer->flush();
+
+  Checkpointer::State state;
+  state.time             = time;
+  state.deltat           = deltat;
+  state.deltat_old       = deltat_old;
+  state.last_output_time = last_output_time;
+  state.time_step        = time_step;
+  state.output_index     = tt;
+  for (const auto &trigger : output_triggers)
+    state.triggers_fired.push_back(trigger.fired);
+
+  checkpointer->save({local_values(solution), local_values(solution_old)}, state);
+
+  timer.leave_subsection();
+}
+
+void
+HeatNonLinear::load_checkpoint() {
+  auto [values, state] = Checkpointer(mpi_comm, restart_directory).load();
+
+  AssertThrow(values.size() == 2 &&
+                values[0].size() == locally_owned_dofs.n_elements() &&
+                values[1].size() == locally_owned_dofs.n_elements() &&
+                state.triggers_fired.size() == output_triggers.size(),
+              ExcMessage("The checkpoint does not match the problem."));
+
+  std::copy(values[0].begin(), values[0].end(), solution_owned.begin());
+  solution = solution_owned;
+
+  TrilinosWrappers::MPI::Vector old_owned(locally_owned_dofs, mpi_comm);
+  std::copy(values[1].begin(), values[1].end(), old_owned.begin());
+  solution_old = old_owned;
+
+  time             = state.time;
+  deltat           = state.deltat;
+  deltat_old       = state.deltat_old;
+  last_output_time = state.last_output_time;
+  time_step        = state.time_step;
+  tt               = state.output_index;
+  for (unsigned int k = 0; k < output_triggers.size(); ++k)
+    output_triggers[k].fired = state.triggers_fired[k];
+
+  pcout << "Restarted at t = " << std::fixed << time << ", time step " << time_step
+        << std::endl;
+}
+
+void
+HeatNonLinear::solve() {
+  pcout << "===============================================" << std::endl;
+
+  // Apply the initial condition, or read the state from the checkpoint.
+  {
+      if (!restart_directory.empty()) {
+        load_checkpoint();
+      } else {
+        pcout << "Applying the initial condition" << std::endl;
+
+        apply_initial_condition();
+        write_diagnostics();
+        write_probes();
+
+        // Output the initial solution.
+          if (output_enabled()) {
+            timer.enter_subsection("Writing");
+            output(tt, time, solution);
+            timer.leave_subsection();
+            tt++;
+          }
+      }
+    pcout << "-----------------------------------------------" << std::endl;
+  }
+
+  advance(T);
+
+  // Wait for the last checkpoint.
+  if (checkpointer)
+    checkpointer->commit(true);
+
+  // Flush the output file, which may have been deferred until now, and report
+  // the time spent writing the outputs.
+    if (writer) {
+      Timer flush_watch;
+      writer->flush();
+      pcout << "Output files written in " << std::fixed << std::setprecision(3)
+            << writer->get_write_time() << " s, final flush in " << flush_watch.wall_time()
+            << " s" << std::endl;
+
+      // Compression ratio and bandwidth (with respect to the uncompressed
+      // size) of the field values of each output.
+        for (const auto &stats : writer->get_statistics()) {
+          const double raw_bytes = stats.raw_bytes;
+          const double ratio     = raw_bytes / std::max<double>(stats.stored_bytes, 1);
+          const double bandwidth = raw_bytes / 1e6 / std::max(stats.write_time, 1e-9);
+
+          pcout << "  output " << std::setw(4) << stats.index << ", t = " << std::setw(6)
+                << std::fixed << std::setprecision(3) << stats.time
+                << ": compression ratio = " << std::setprecision(2) << ratio
+                << ", bandwidth = " << bandwidth << " MB/s" << std::endl;
+        }
+    }
+
+  print_load_balance();
+  print_memory_report("at the end");
+
+#ifdef PRION_PERF_COUNTERS
+  perf_counters->print(pcout);
+#endif
+}
+
+void
+HeatNonLinear::print_load_balance() {
+  pcout << "===============================================" << std::endl;
+  pcout << "Load balance over " << mpi_size << " processes (min / avg / max, rank of max)"
+        << std::endl;
+
+  unsigned int n_ghost_cells = 0;
+  for (const auto &cell : mesh.active_cell_iterators())
+    if (cell->is_ghost())
+      ++n_ghost_cells;
+
+  const std::vector<std::pair<std::string, double>> quantities = {
+    {"Owned cells", mesh.n_locally_owned_active_cells()},
+    {"Ghost cells", n_ghost_cells},
+    {"Owned DoFs", locally_owned_dofs.n_elements()}};
+
+    for (const auto &[name, value] : quantities) {
+      const auto stats = Utilities::MPI::min_max_avg(value, mpi_comm);
+
+      pcout << "  " << std::left << std::setw(12) << name << std::right << std::fixed
+            << std::setprecision(0) << " = " << stats.min << " / " << stats.avg << " / "
+            << stats.max << ", rank " << stats.max_index << ", max / avg = "
+            << std::setprecision(2) << stats.max / std::max(stats.avg, 1.0) << std::endl;
+    }
+
+  // Wall time of each section, with the ranks of the minimum and maximum.
+  timer.print_wall_time_statistics(mpi_comm);
+}
+
+void
+HeatNonLinear::print_memory_report(const std::string &label) {
+  const double MB = 1024.0 * 1024.0;
+
+  const double other_matrices_memory =
+    mass_matrix.memory_consumption() + stiffness_matrix.memory_consumption() +
+    diffusion_matrix.memory_consumption() + lumped_matrix.memory_consumption();
+
+  // Resident set size of the process, now and at its peak (in kB).
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats(stats);
+
+  const std::vector<std::pair<std::string, double>> entries = {
+    {"Serial mesh (setup)", serial_mesh_memory / MB},
+    {"Triangulation", mesh.memory_consumption() / MB},
+    {"DoF handler", dof_handler.memory_consumption() / MB},
+    {"jacobian_matrix", jacobian_matrix.memory_consumption() / MB},
+    {"Other matrices", other_matrices_memory / MB},
+    {"residual_vector", residual_vector.memory_consumption() / MB},
+    {"delta_owned", delta_owned.memory_consumption() / MB},
+    {"solution_owned", solution_owned.memory_consumption() / MB},
+    {"solution", solution.memory_consumption() / MB},
+    {"solution_old", solution_old.memory_consumption() / MB},
+    {"solution_older", solution_older.memory_consumption() / MB},
+    {"Process RSS", stats.VmRSS / 1024.0},
+    {"Process peak RSS", stats.VmHWM / 1024.0}};
+
+  pcout << "===============================================" << std::endl;
+  pcout << "Memory " << label << " (MB per process: min / max, rank of max)" << std::endl;
+
+    for (const auto &[name, value] : entries) {
+      const auto minmax = Utilities::MPI::min_max_avg(value, mpi_comm);
+
+      pcout << "  " << std::left << std::setw(20) << name << std::right << std::fixed
+            << std::setprecision(1) << " = " << minmax.min << " / " << minmax.max
+            << ", rank " << minmax.max_index << std::endl;
+    }
+}
+
+void
+HeatNonLinear::apply_initial_condition() {
+  VectorTools::interpolate(dof_handler, u_0, solution_owned);
+  solution = solution_owned;
+
+  time      = 0.0;
+  time_step = 0;
+  tt        = 0;
+
+  last_output_time = time;
+  for (auto &trigger : output_triggers)
+    trigger.fired = false;
+}
+
+void
+HeatNonLinear::set_state(const TrilinosWrappers::MPI::Vector &u, const double &time_) {
+  solution_owned = u;
+  solution       = solution_owned;
+
+  time      = time_;
+  time_step = 0;
+
+  last_output_time = time;
+}
+
+void
+HeatNonLinear::advance(const double &time_end_) {
+  time_end = time_end_;
+
+  // With adaptive time stepping, we stop once we are closer to the end time
+  // than half of the minimum step. With a fixed step, the last step is
+  // shortened to end exactly at the end time, and only round-off is tolerated.
+  const double end_tolerance = adaptive.enabled ? 0.5 * adaptive.min_deltat : 1e-9 * deltat;
+
+    while (time < time_end - end_tolerance) {
+      Timer step_watch;
+
+      const double time_start = time;
       ++time_step;
 
-      // Store the old solution, so that it is available for assembly.
+      // Store the old solutions, so that they are available for assembly. The
+      // older solution takes the storage of the old one, which is then
+      // overwritten.
+      solution_older.swap(solution_old);
       solution_old = solution;
 
-      pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
-            << std::fixed << time << std::endl;
+        // The lumped assembly uses owned copies of the old solutions.
+        if (mass_lumping) {
+          solution_older_owned.swap(solution_old_owned);
+          solution_old_owned = solution_old;
+        }
 
       // At every time step, we invoke Newton's method to solve the non-linear
       // problem.
-      solve_newton();
-      
-      if(!(time_step % 30)) {
-        timer.enter_subsection("Writing");
-      	output(tt, time);
-        timer.leave_subsection();
-	tt++;
-      }
+      solve_time_step();
+
+      // With adaptive stepping, deltat is already the size proposed for the
+      // next step: the accepted one is logged.
+      write_telemetry("step",
+                      time_step,
+                      step_stats.newton_iterations,
+                      step_stats,
+                      step_watch.wall_time(),
+                      time - time_start);
+
+      write_diagnostics();
+      write_probes();
+
+      const bool stop = check_stopping_criterion();
+
+      write_outputs(time_start, stop);
+
+        if (checkpointer) {
+          if (!(time_step % checkpoint_frequency))
+            write_checkpoint();
+          else
+            checkpointer->commit(false);
+        }
 
       pcout << std::endl;
+
+        if (stop) {
+          pcout << "Stopping criterion met at t = " << std::fixed << time << std::endl;
+          break;
+        }
+    }
+}
+
+double
+HeatNonLinear::compute_mass() {
+  const unsigned int n_q = quadrature->size();
+
+  FEValues<dim> fe_values(*fe, *quadrature, update_values | update_JxW_values);
+
+  std::vector<double> solution_loc(n_q);
+
+  double mass   = 0.0;
+  double volume = 0.0;
+
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
+
+      fe_values.reinit(cell);
+      fe_values.get_function_values(solution, solution_loc);
+
+        for (unsigned int q = 0; q < n_q; ++q) {
+          mass += solution_loc[q] * fe_values.JxW(q);
+          volume += fe_values.JxW(q);
+        }
+    }
+
+  domain_volume = Utilities::MPI::sum(volume, mpi_comm);
+
+  return Utilities::MPI::sum(mass, mpi_comm);
+}
+
+HeatNonLinear::Diagnostics
+HeatNonLinear::compute_diagnostics() {
+  const unsigned int n_q = quadrature->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_quadrature_points | update_JxW_values);
+
+  std::vector<double> solution_loc(n_q);
+
+  // Sums (mass, affected volume) and maxima (max u, -min u, front distance),
+  // reduced with one call each.
+  std::vector<double> sums(2, 0.0);
+  std::vector<double> maxima(3, std::numeric_limits<double>::lowest());
+
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
+
+      fe_values.reinit(cell);
+      fe_values.get_function_values(solution, solution_loc);
+
+        for (unsigned int q = 0; q < n_q; ++q) {
+          sums[0] += solution_loc[q] * fe_values.JxW(q);
+
+            if (solution_loc[q] > diagnostics_threshold) {
+              sums[1] += fe_values.JxW(q);
+              maxima[2] =
+                std::max(maxima[2], fe_values.quadrature_point(q).distance(u_0.center));
+            }
+        }
+    }
+
+  // Extrema of the nodal values.
+    for (auto it = solution_owned.begin(); it != solution_owned.end(); ++it) {
+      maxima[0] = std::max(maxima[0], *it);
+      maxima[1] = std::max(maxima[1], -*it);
+    }
+
+  Utilities::MPI::sum(sums, mpi_comm, sums);
+  Utilities::MPI::max(maxima, mpi_comm, maxima);
+
+  Diagnostics result;
+  result.mass            = sums[0];
+  result.affected_volume = sums[1];
+  result.max_u           = maxima[0];
+  result.min_u           = -maxima[1];
+  result.front_distance  = std::max(maxima[2], 0.0);
+
+  return result;
+}
+
+void
+HeatNonLinear::write_diagnostics() {
+  if (!diagnostics_enabled)
+    return;
+
+  timer.enter_subsection("Diagnostics");
+  const Diagnostics result = compute_diagnostics();
+  timer.leave_subsection();
+
+    if (diagnostics.is_open()) {
+      diagnostics << time_step << ',' << std::defaultfloat << time << ','
+                  << std::scientific << std::setprecision(6) << result.mass << ','
+                  << result.affected_volume << ',' << result.min_u << ','
+                  << result.max_u << ',' << result.front_distance << std::endl;
     }
 }
+
+void
+HeatNonLinear::setup_probes() {
+  pcout << "Locating " << probe_points.size() << " probes" << std::endl;
+
+  // R-tree of the bounding boxes of the locally owned cells.
+  std::vector<DoFHandler<dim>::active_cell_iterator>     cells;
+  std::vector<std::pair<BoundingBox<dim>, unsigned int>> boxes;
+
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
+
+      boxes.emplace_back(cell->bounding_box(), cells.size());
+      cells.push_back(cell);
+    }
+
+  const auto rtree = pack_rtree(boxes);
+
+  // Process owning each probe (the one with the lowest rank, for points on the
+  // interface between processes), or mpi_size if not found.
+  std::vector<unsigned int> owner(probe_points.size(), mpi_size);
+  std::vector<Probe>        candidates;
+
+    for (unsigned int p = 0; p < probe_points.size(); ++p) {
+      std::vector<std::pair<BoundingBox<dim>, unsigned int>> hits;
+      rtree.query(boost::geometry::index::intersects(probe_points[p]),
+                  std::back_inserter(hits));
+
+        for (const auto &hit : hits) {
+          const auto &cell = cells[hit.second];
+
+          // Reference coordinates of the point, given that the cells are
+          // straight-sided simplices: x = v_0 + J xi, with the edges from v_0
+          // as columns of J.
+          Tensor<2, dim> jacobian;
+          for (unsigned int d = 0; d < dim; ++d)
+            for (unsigned int k = 0; k < dim; ++k)
+              jacobian[d][k] = cell->vertex(k + 1)[d] - cell->vertex(0)[d];
+
+          const Tensor<1, dim> xi =
+            invert(jacobian) * (probe_points[p] - cell->vertex(0));
+
+          // The point is in the cell if all its barycentric coordinates (xi
+          // and 1 - sum xi) are non-negative.
+          double barycentric_0  = 1.0;
+          double min_coordinate = 1.0;
+            for (unsigned int k = 0; k < dim; ++k) {
+              barycentric_0 -= xi[k];
+              min_coordinate = std::min(min_coordinate, xi[k]);
+            }
+          min_coordinate = std::min(min_coordinate, barycentric_0);
+
+          if (min_coordinate < -1e-10)
+            continue;
+
+          Probe probe;
+          probe.index = p;
+          probe.dof_indices.resize(fe->dofs_per_cell);
+          cell->get_dof_indices(probe.dof_indices);
+          for (unsigned int i = 0; i < fe->dofs_per_cell; ++i)
+            probe.shape_values.push_back(fe->shape_value(i, Point<dim>(xi)));
+
+          candidates.push_back(probe);
+          owner[p] = mpi_rank;
+          break;
+        }
+    }
+
+  Utilities::MPI::min(owner, mpi_comm, owner);
+
+  local_probes.clear();
+  for (const auto &probe : candidates)
+    if (owner[probe.index] == mpi_rank)
+      local_probes.push_back(probe);
+
+  const unsigned int n_missing = std::count(owner.begin(), owner.end(), mpi_size);
+  if (n_missing > 0)
+    pcout << "  " << n_missing << " probes are outside of the mesh" << std::endl;
+}
+
+void
+HeatNonLinear::write_probes() {
+  if (probe_points.empty())
+    return;
+
+  // Values of the probes owned by this process (0 for the others), summed
+  // over the processes with a single reduction. The second half of the vector
+  // flags the probes that were located.
+  const unsigned int  n_probes = probe_points.size();
+  std::vector<double> values(2 * n_probes, 0.0);
+
+    for (const auto &probe : local_probes) {
+      for (unsigned int i = 0; i < probe.dof_indices.size(); ++i)
+        values[probe.index] += probe.shape_values[i] * solution[probe.dof_indices[i]];
+      values[n_probes + probe.index] = 1.0;
+    }
+
+  Utilities::MPI::sum(values, mpi_comm, values);
+
+    if (probes.is_open()) {
+      probes << time_step << ',' << std::defaultfloat << time << std::scientific
+             << std::setprecision(6);
+      for (unsigned int p = 0; p < n_probes; ++p)
+        probes << ','
+               << (values[n_probes + p] > 0.0 ? values[p]
+                                              : std::numeric_limits<double>::quiet_NaN());
+      probes << std::endl;
+    }
+}
+
+bool
+HeatNonLinear::check_stopping_criterion() {
+  bool stop = false;
+
+    if (stopping.change_tolerance > 0.0) {
+      TrilinosWrappers::MPI::Vector change(locally_owned_dofs, mpi_comm);
+      change = solution_old;
+      change.sadd(-1.0, 1.0, solution_owned);
+
+      const double relative_change = change.l2_norm() / solution_owned.l2_norm();
+      pcout << "  ||u_{n+1} - u_n|| / ||u_{n+1}|| = " << std::scientific
+            << relative_change << std::endl;
+
+      stop = stop || relative_change < stopping.change_tolerance;
+    }
+
+    if (stopping.min_threshold > 0.0) {
+      const double min_u = solution_owned.min();
+      pcout << "  min u = " << std::scientific << min_u << std::endl;
+
+      stop = stop || min_u >= stopping.min_threshold;
+    }
+
+    if (stopping.mass_fraction > 0.0) {
+      const double mass = compute_mass();
+      pcout << "  mass = " << std::scientific << mass << " (" << std::fixed
+            << std::setprecision(2) << 100.0 * mass / domain_volume << "% of saturation)"
+            << std::endl;
+
+      stop = stop || mass >= stopping.mass_fraction * domain_volume;
+    }
+
+  return stop;
+}
+
+void
+HeatNonLinear::set_stopping_criterion(const double &change_tolerance,
+                                      const double &min_threshold,
+                                      const double &mass_fraction) {
+  stopping.change_tolerance = change_tolerance;
+  stopping.min_threshold    = min_threshold;
+  stopping.mass_fraction    = mass_fraction;
+}
+
+void
+HeatNonLinear::set_mass_lumping(const bool &mass_lumping_) {
+  mass_lumping = mass_lumping_;
+}
+
+void
+HeatNonLinear::set_time_step(const double &deltat_) {
+  deltat     = deltat_;
+  deltat_old = deltat_;
+}
+
+void
+HeatNonLinear::set_diagnostics_file(const std::string &file_name, const double &threshold) {
+  diagnostics_enabled   = true;
+  diagnostics_threshold = threshold;
+
+  if (mpi_rank != 0)
+    return;
+
+  // When restarting, the records are appended to the file.
+  const bool append = !restart_directory.empty();
+
+  diagnostics.open(file_name, append ? std::ios::app : std::ios::out);
+  AssertThrow(diagnostics,
+              ExcMessage("Could not open the diagnostics file " + file_name));
+
+  if (!append)
+    diagnostics << "time_step,time,mass,affected_volume,min_u,max_u,front_distance"
+                << std::endl;
+}
+
+void
+HeatNonLinear::set_probes(const std::vector<Point<dim>> &points,
+                          const std::string             &file_name) {
+  probe_points = points;
+
+  if (mpi_rank != 0)
+    return;
+
+  // When restarting, the records are appended to the file.
+  const bool append = !restart_directory.empty();
+
+  probes.open(file_name, append ? std::ios::app : std::ios::out);
+  AssertThrow(probes, ExcMessage("Could not open the probe file " + file_name));
+
+    if (!append) {
+      probes << "time_step,time";
+      for (unsigned int p = 0; p < probe_points.size(); ++p)
+        probes << ",p" << p;
+      probes << std::endl;
+    }
+}
+
+void
+HeatNonLinear::set_telemetry_file(const std::string &file_name) {
+  if (mpi_rank != 0)
+    return;
+
+  // When restarting, the records are appended to the file.
+  const bool append = !restart_directory.empty();
+
+  telemetry.open(file_name, append ? std::ios::app : std::ios::out);
+  AssertThrow(telemetry, ExcMessage("Could not open the telemetry file " + file_name));
+
+  if (!append)
+    telemetry << "kind,time_step,time,deltat,newton_iter,residual_norm,linear_iters,"
+              << "assemble_time,preconditioner_time,linear_solve_time,ghost_update_time,"
+              << "wall_time" << std::endl;
+}
+
+void
+HeatNonLinear::set_preconditioner(const Preconditioner &preconditioner_) {
+  preconditioner = preconditioner_;
+}
+
+#ifdef PRION_PERF_COUNTERS
+void
+HeatNonLinear::set_flop_events(const std::vector<PerfCounters::FlopEvent> &events) {
+  flop_events = events;
+}
+#endif
+
+void
+HeatNonLinear::set_time_scheme(const TimeScheme &scheme, const double &theta_) {
+  AssertThrow(0.0 < theta_ && theta_ <= 1.0, ExcMessage("theta must be in (0, 1]."));
+
+  time_scheme = scheme;
+  theta       = theta_;
+}
+
+void
+HeatNonLinear::set_mesh_file(const std::string &file_name) {
+  mesh_file_name = file_name;
+}
+
+void
+HeatNonLinear::set_mesh_group_size(const unsigned int &group_size) {
+  mesh_group_size = group_size;
+}
+
+void
+HeatNonLinear::set_initial_condition(const FunctionU0 &u_0_) {
+  u_0 = u_0_;
+}
+
+void
+HeatNonLinear::set_output_frequency(const unsigned int &frequency) {
+  output_frequency = frequency;
+}
+
+void
+HeatNonLinear::set_checkpointing(const std::string  &directory,
+                                 const unsigned int &frequency) {
+  checkpoint_directory = directory;
+  checkpoint_frequency = frequency;
+}
+
+void
+HeatNonLinear::set_restart(const std::string &directory) {
+  restart_directory = directory;
+}
+
+void
+HeatNonLinear::set_output_interval(const double &interval) {
+  output_interval = interval;
+}
+
+void
+HeatNonLinear::set_output_times(const std::vector<double> &times) {
+  output_times = times;
+  std::sort(output_times.begin(), output_times.end());
+}
+
+void
+HeatNonLinear::add_output_trigger(const Point<dim> &center,
+                                  const double     &radius,
+                                  const double     &threshold) {
+  OutputTrigger trigger;
+  trigger.center    = center;
+  trigger.radius    = radius;
+  trigger.threshold = threshold;
+
+  output_triggers.push_back(trigger);
+}
+
+void
+HeatNonLinear::set_output_directory(const std::string &directory) {
+  output_directory = directory;
+}
+
+void
+HeatNonLinear::set_asynchronous_output(const bool &asynchronous) {
+  asynchronous_output = asynchronous;
+}
+
+void
+HeatNonLinear::set_output_compression(const SolutionWriter::Compression &compression,
+                                      const double                      &tolerance) {
+  output_compression = compression;
+  output_tolerance   = tolerance;
+}
+
+void
+HeatNonLinear::set_adaptive_time_stepping(const double &min_deltat,
+                                          const double &max_deltat,
+                                          const double &tolerance) {
+  AssertThrow(0.0 < min_deltat && min_deltat <= max_deltat,
+              ExcMessage("Invalid bounds for the adaptive time step."));
+  AssertThrow(tolerance > 0.0, ExcMessage("The tolerance must be positive."));
+
+  adaptive.enabled    = true;
+  adaptive.min_deltat = min_deltat;
+  adaptive.max_deltat = max_deltat;
+  adaptive.tolerance  = tolerance;
+
+  deltat     = std::clamp(deltat, min_deltat, max_deltat);
+  deltat_old = deltat;
+}
+
+void
+HeatNonLinear::write_telemetry(const std::string  &kind,
+                               const unsigned int &time_step,
+                               const unsigned int &newton_iteration,
+                               const SolverStats  &stats,
+                               const double       &wall_time,
+                               const double       &step_size) {
+  if (!telemetry.is_open())
+    return;
+
+  // The stream is flushed at every record, so that the file can be inspected
+  // while the simulation is running (and survives a killed job).
+  telemetry << kind << ',' << time_step << ',' << std::defaultfloat << time << ','
+            << step_size << ',' << newton_iteration << ',' << std::scientific
+            << std::setprecision(6) << stats.residual_norm << ','
+            << stats.linear_iterations << ',' << stats.assemble_time << ','
+            << stats.preconditioner_time << ',' << stats.linear_solve_time << ','
+            << stats.ghost_update_time << ',' << wall_time << std::endl;
+}
@@ -2,6 +2,7 @@
 #define PRION_HPP
 
 #include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/partitioner.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/timer.h>
 
@@ -28,10 +29,22 @@
 
 #include <deal.II/numerics/data_out.h>
 #include <deal.II/numerics/matrix_tools.h>
+#include <deal.II/numerics/rtree.h>
 #include <deal.II/numerics/vector_tools.h>
 
+#include "Checkpointer.hpp"
+#include "SolutionWriter.hpp"
+
+#ifdef PRION_PERF_COUNTERS
+#  include "PerfCounters.hpp"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 
 using namespace dealii;
 
@@ -86,38 +99,78 @@ public:
     return result;
   }
 
-  // Function for initial conditions.
+  // Function for initial conditions: a Gaussian seed of given amplitude and
+  // sharpness, truncated to a box of given half width around its center.
   class FunctionU0 : public Function<dim> {
   public:
+    // The default parameters are those of the seed for the brain mesh. For the
+    // cube mesh, use FunctionU0(Point<dim>(0.5, 0.5, 0.5), 0.1, 0.1, 30).
+    FunctionU0(const Point<dim> &center_     = Point<dim>(50, 80, 70),
+               const double     &half_width_ = 1.0,
+               const double     &amplitude_  = 1.0,
+               const double     &sharpness_  = 2.0) :
+      center(center_), half_width(half_width_), amplitude(amplitude_),
+      sharpness(sharpness_) {}
+
     virtual double
     value(const Point<dim> &p, const unsigned int /*component*/ = 0) const override {
-      // for the cube mesh
-      // if (p[0] > 0.4 && p[0] < 0.6 && p[1] > 0.4 && p[1] < 0.6 && p[2] > 0.4 &&
-      //     p[2] < 0.6)
-      //   return 0.1 *
-      //          std::exp(-std::pow(30 * (p[0] - 0.5), 2) - std::pow(30 * (p[1] - 0.5), 2) -
-      //                   std::pow(30 * (p[2] - 0.5), 2));
-
-      // for the brain mesh
-      if (p[0] > 49 && p[0] < 51 && p[1] > 79 && p[1] < 81 && p[2] > 69 && p[2] < 71)
-        return 1.0 *
-               std::exp(-std::pow(2 * (p[0] - 50), 2) - std::pow(2 * (p[1] - 80), 2) -
-                        std::pow(2 * (p[2] - 70), 2));
-
-      return 0.0;
+      double exponent = 0.0;
+
+        for (unsigned int d = 0; d < dim; ++d) {
+          if (std::abs(p[d] - center[d]) >= half_width)
+            return 0.0;
+
+          exponent -= std::pow(sharpness * (p[d] - center[d]), 2);
+        }
+
+      return amplitude * std::exp(exponent);
     }
+
+    Point<dim> center;
+    double     half_width;
+    double     amplitude;
+    double     sharpness;
+  };
+
+  // Time discretization schemes.
+  enum class TimeScheme {
+    // First order, A-stable and L-stable.
+    BackwardEuler,
+    // Second order backward differentiation formula (with variable step).
+    // The first step is taken with backward Euler.
+    BDF2,
+    // Theta method; second order for theta = 1/2 (Crank-Nicolson).
+    Theta,
+    // Strang splitting of diffusion and reaction: half a step of the logistic
+    // reaction, solved exactly at each node, a backward Euler diffusion step
+    // with the constant matrix M / deltat + K, and another half reaction step.
+    // No Newton iterations and no re-assembly are needed; the scheme is first
+    // order because of the diffusion step.
+    StrangSplitting,
+    // Exponential Rosenbrock-Euler: u_{n+1} = u_n + deltat phi_1(deltat J) f(u_n),
+    // with J the Jacobian of the right-hand side f at u_n. The action of phi_1
+    // is computed with Arnoldi projections. Second order.
+    ExponentialEuler
   };
 
+  // Preconditioners of the Newton linear systems (with consistent mass).
+  enum class Preconditioner { SSOR, Jacobi, AMG };
+
   // Constructor. We provide the final time, time step Delta t and theta method
-  // parameter as constructor arguments.
+  // parameter as constructor arguments. The problem is distributed over the
+  // processes of the given communicator; only the first process of
+  // MPI_COMM_WORLD prints to screen.
   HeatNonLinear(const unsigned int &N_,
                 const unsigned int &r_,
                 const double       &T_,
-                const double       &deltat_) :
-    mpi_size(Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD)),
-    mpi_rank(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)),
-    pcout(std::cout, mpi_rank == 0), T(T_), N(N_), r(r_), deltat(deltat_),
-    mesh(MPI_COMM_WORLD), timer(MPI_COMM_WORLD, pcout, TimerOutput::summary, TimerOutput::wall_times) {
+                const double       &deltat_,
+                const MPI_Comm     &mpi_comm_ = MPI_COMM_WORLD) :
+    mpi_comm(mpi_comm_),
+    mpi_size(Utilities::MPI::n_mpi_processes(mpi_comm)),
+    mpi_rank(Utilities::MPI::this_mpi_process(mpi_comm)),
+    pcout(std::cout, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0), T(T_), N(N_),
+    r(r_), deltat(deltat_), deltat_old(deltat_), mesh(mpi_comm),
+    timer(mpi_comm, pcout, TimerOutput::summary, TimerOutput::wall_times) {
     D = set_up_diffusivity();
   }
 
@@ -129,25 +182,311 @@ public:
   void
   solve();
 
+  // Print the minimum, average and maximum across processes (and the rank of
+  // the maximum) of the owned cells, ghost cells and owned DoFs, and of the
+  // wall time of each timer section. Collective.
+  void
+  print_load_balance();
+
+  // Print the memory of the main data structures and the resident set size
+  // of the process, now and at its peak (minimum and maximum across
+  // processes, and the rank of the maximum). Collective.
+  void
+  print_memory_report(const std::string &label);
+
+  // Set the solution to the initial condition, at time 0.
+  void
+  apply_initial_condition();
+
+  // Set the solution at the given time. The vector must be distributed as the
+  // solution of this problem. The solution history is discarded.
+  void
+  set_state(const TrilinosWrappers::MPI::Vector &u, const double &time_);
+
+  // Advance the solution from the current time to the given time.
+  void
+  advance(const double &time_end_);
+
+  // Use a lumped mass matrix for the time derivative and the reaction term.
+  // Then, the reaction is evaluated at the nodes, without quadrature, and the
+  // Jacobian is the constant matrix M_L / deltat + K plus a diagonal term, so
+  // that the preconditioner of the constant matrix can be reused across
+  // Newton iterations. With backward Euler and if K is an M-matrix (e.g. on
+  // meshes without obtuse angles), the solution stays non-negative. Applies
+  // to the Newton-based schemes and to the exponential integrator.
+  void
+  set_mass_lumping(const bool &mass_lumping_);
+
+  // Set the time step (the initial one, if the step is adaptive).
+  void
+  set_time_step(const double &deltat_);
+
+  // Stop the time loop as soon as one of the following is met (a value of 0
+  // disables the corresponding criterion):
+  // - the relative change ||u_{n+1} - u_n|| / ||u_{n+1}|| is below
+  //   change_tolerance;
+  // - the minimum of u is at least min_threshold;
+  // - the total mass int u is at least mass_fraction times the volume of the
+  //   domain (i.e. the mass of the saturated state u = 1).
+  // The final state is then written once.
+  void
+  set_stopping_criterion(const double &change_tolerance,
+                         const double &min_threshold,
+                         const double &mass_fraction);
+
+  // Write a CSV record per Newton iteration and per time step (residual
+  // norms, linear iterations and wall times) to the given file.
+  void
+  set_telemetry_file(const std::string &file_name);
+
+  // After every time step, write to the given CSV file the total mass int u,
+  // the volume where u > threshold, the minimum and maximum of u and the
+  // largest distance from the center of the seed at which u > threshold (the
+  // position of the front).
+  void
+  set_diagnostics_file(const std::string &file_name, const double &threshold = 0.5);
+
+  // Sample u at the given points after every time step, and write the values
+  // to the given CSV file (one column per point). The points are located in
+  // setup(); points outside of the mesh are reported and sampled as NaN.
+  void
+  set_probes(const std::vector<Point<dim>> &points, const std::string &file_name);
+
+  // Select the time discretization scheme (backward Euler by default). theta
+  // is only used by TimeScheme::Theta.
+  void
+  set_time_scheme(const TimeScheme &scheme, const double &theta = 0.5);
+
+  // Read the mesh from the given Gmsh file (by default, the half brain mesh).
+  // If the name is empty, a cube mesh with N + 1 subdivisions per side is
+  // generated instead.
+  void
+  set_mesh_file(const std::string &file_name);
+
+  // Build the serial mesh only on the first process of each group of the given
+  // number of consecutive processes, which partitions it and sends their part
+  // to the others (0, the default, for one group per node). Larger groups use
+  // less memory in total, but more on the first process of each group.
+  void
+  set_mesh_group_size(const unsigned int &group_size);
+
+  // Set the initial condition.
+  void
+  set_initial_condition(const FunctionU0 &u_0_);
+
+  // Write a checkpoint to the given directory every given number of time
+  // steps (0 disables checkpoints).
+  void
+  set_checkpointing(const std::string &directory, const unsigned int &frequency);
+
+  // Restart from the last checkpoint in the given directory, which must have
+  // been written with the same number of processes. The mesh is taken from
+  // the checkpoint, and the output time series and the CSV files (if they are
+  // enabled after this call) are continued.
+  void
+  set_restart(const std::string &directory);
+
+  // Write the solution every given number of time steps (0 disables output).
+  void
+  set_output_frequency(const unsigned int &frequency);
+
+  // Write the solution at the multiples of the given time interval (0
+  // disables it). The solution is interpolated linearly in time between the
+  // two steps around each output time.
+  void
+  set_output_interval(const double &interval);
+
+  // Write the solution at the given times, interpolated as above.
+  void
+  set_output_times(const std::vector<double> &times);
+
+  // Write the solution once, as soon as u exceeds threshold at some vertex
+  // within distance radius from center (e.g. when the front reaches a region).
+  void
+  add_output_trigger(const Point<dim> &center,
+                     const double     &radius,
+                     const double     &threshold);
+
+  // Set the directory of the output files.
+  void
+  set_output_directory(const std::string &directory);
+
+  // Defer the flush of the output file to checkpoints and to the end of the
+  // run (the default), so that the time loop does not wait for the data to
+  // reach the storage after each output.
+  void
+  set_asynchronous_output(const bool &asynchronous);
+
+  // Compress the output datasets (see SolutionWriter::Compression); tolerance
+  // is the absolute error bound of lossy compression.
+  void
+  set_output_compression(const SolutionWriter::Compression &compression,
+                         const double                      &tolerance = 0.0);
+
+  // Solution at the current time.
+  const TrilinosWrappers::MPI::Vector &
+  get_solution() const {
+    return solution;
+  }
+
+  // Enable adaptive time stepping. The step is chosen so that the estimated
+  // local error (in the maximum norm) stays below the given tolerance, within
+  // the bounds [min_deltat, max_deltat]. The time step given to the
+  // constructor is used as the initial step. Steps where Newton's method or
+  // its linear solver fails are rejected and retried with half the step.
+  void
+  set_adaptive_time_stepping(const double &min_deltat,
+                             const double &max_deltat,
+                             const double &tolerance);
+
+  // Select the preconditioner of the Newton linear systems (SSOR by default).
+  void
+  set_preconditioner(const Preconditioner &preconditioner_);
+
+#ifdef PRION_PERF_COUNTERS
+  // Also count the floating point operations of the instrumented sections,
+  // with the given raw events of this processor (see PerfCounters::FlopEvent).
+  void
+  set_flop_events(const std::vector<PerfCounters::FlopEvent> &events);
+#endif
+
 protected:
-  // Assemble the tangent problem.
+  // Assemble the tangent problem (only the residual, if residual_only). The
+  // interior cells are assembled first, so that a pending ghost exchange of
+  // the solution completes meanwhile.
+  void
+  assemble_system(const bool &residual_only = false);
+
+  // Copy solution_owned into the locally owned values of solution, and start
+  // receiving its ghost values, without waiting for them.
+  void
+  start_ghost_update();
+
+  // Wait for the ghost values of solution, if an exchange is pending.
+  void
+  finish_ghost_update();
+
+  // Compute the coefficients of the time discretization for the current step.
+  void
+  update_time_coefficients();
+
+  // Assemble the tangent problem with lumped mass.
+  void
+  assemble_system_lumped();
+
+  // Assemble the mass and stiffness matrices, the lumped mass matrix and the
+  // nodal values of alpha (only the first time it is called).
+  void
+  assemble_constant_matrices();
+
+  // Build the diffusion matrix M / deltat + K and its preconditioner, if they
+  // were not built for the current time step.
+  void
+  update_diffusion_matrix();
+
+  // Solve the problem for one time step using Strang splitting.
   void
-  assemble_system();
+  solve_splitting();
+
+  // Advance the nodal values of solution_owned by the exact solution of the
+  // logistic equation u' = alpha u (1 - u) over the time interval tau.
+  void
+  apply_reaction(const double &tau);
+
+  // Solve the problem for one time step using the exponential Euler method.
+  void
+  solve_exponential();
 
   // Solve the linear system associated to the tangent problem.
   void
   solve_linear_system();
 
-  // Solve the problem for one time step using Newton's method.
-  void
+  // Solve the problem for one time step using Newton's method. Returns false
+  // if Newton's method did not converge.
+  bool
   solve_newton();
 
-  // Output.
+  // Advance the solution by one time step, selecting (and possibly rejecting
+  // and retrying) the step size if adaptive time stepping is enabled.
+  void
+  solve_time_step();
+
+  // Output of the given solution at the given time.
+  void
+  output(const unsigned int                  &time_step,
+         const double                        &time,
+         const TrilinosWrappers::MPI::Vector &u);
+
+  // Whether any output is requested.
+  bool
+  output_enabled() const;
+
+  // Next scheduled output time (by interval or requested times) after t, or
+  // infinity if there is none.
+  double
+  next_output_time(const double &t) const;
+
+  // Start writing a checkpoint of the current state.
+  void
+  write_checkpoint();
+
+  // Read the state from the last checkpoint in the restart directory.
+  void
+  load_checkpoint();
+
+  // Find the vertices of the locally owned DoFs in the region of each output
+  // trigger.
+  void
+  setup_output_triggers();
+
+  // Check the output triggers; returns true if any of them fired.
+  bool
+  check_output_triggers();
+
+  // Write the outputs due after a time step that started at time_start: those
+  // at scheduled times within the step, and the current solution if required
+  // by the output frequency, by a trigger or by stopping.
+  void
+  write_outputs(const double &time_start, const bool &stop);
+
+  // Compute the integral of the solution over the domain (the prion mass).
+  double
+  compute_mass();
+
+  // Check whether the stopping criterion is met after a time step.
+  bool
+  check_stopping_criterion();
+
+  // Scalar quantities of the current solution (see set_diagnostics_file()).
+  struct Diagnostics {
+    double mass            = 0.0;
+    double affected_volume = 0.0;
+    double min_u           = 0.0;
+    double max_u           = 0.0;
+    double front_distance  = 0.0;
+  };
+
+  // Compute the diagnostics of the current solution.
+  Diagnostics
+  compute_diagnostics();
+
+  // Compute the diagnostics and write them (if enabled).
+  void
+  write_diagnostics();
+
+  // Locate the probe points in the locally owned cells.
+  void
+  setup_probes();
+
+  // Evaluate u at the probe points and write the values (if enabled).
   void
-  output(const unsigned int &time_step, const double &time) const;
+  write_probes();
 
   // MPI parallel. /////////////////////////////////////////////////////////////
 
+  // MPI communicator.
+  const MPI_Comm mpi_comm;
+
   // Number of MPI processes.
   const unsigned int mpi_size;
 
@@ -171,6 +510,82 @@ protected:
   // Final time.
   const double T;
 
+  // End time of the current call to advance().
+  double time_end;
+
+  // Path of the mesh file (empty for the cube mesh).
+  std::string mesh_file_name = "../mesh/half-brain.msh";
+
+  // Number of processes sharing a serial mesh in setup() (0 for one group per
+  // node).
+  unsigned int mesh_group_size = 0;
+
+  // Output frequency, in time steps (0 for no output).
+  unsigned int output_frequency = 30;
+
+  // Output interval, in time (0 for no output), and requested output times
+  // (sorted).
+  double              output_interval = 0.0;
+  std::vector<double> output_times;
+
+  // Time of the last scheduled output.
+  double last_output_time = 0.0;
+
+  // Output trigger: a region (a ball) and a threshold of u, and the locally
+  // owned DoFs at the vertices in the region.
+  struct OutputTrigger {
+    Point<dim>                           center;
+    double                               radius;
+    double                               threshold;
+    std::vector<types::global_dof_index> dofs;
+    bool                                 fired = false;
+  };
+
+  std::vector<OutputTrigger> output_triggers;
+
+  // Directory of the output files.
+  std::string output_directory = ".";
+
+  // Whether the flush of the output file is deferred.
+  bool asynchronous_output = true;
+
+  // Compression of the output datasets and error bound of lossy compression.
+  SolutionWriter::Compression output_compression = SolutionWriter::Compression::None;
+  double                      output_tolerance   = 0.0;
+
+  // Writer of the output files, created at the first output.
+  std::unique_ptr<SolutionWriter> writer;
+
+  // Checkpoint directory and frequency (in time steps, 0 for no checkpoints),
+  // and directory of the checkpoint to restart from (empty for no restart).
+  std::string  checkpoint_directory;
+  unsigned int checkpoint_frequency = 0;
+  std::string  restart_directory;
+
+  // Writer of the checkpoints.
+  std::unique_ptr<Checkpointer> checkpointer;
+
+#ifdef PRION_PERF_COUNTERS
+  // Hardware counters of assembly, SpMV and preconditioner (created in
+  // setup()), and floating point events to count.
+  std::unique_ptr<PerfCounters>        perf_counters;
+  std::vector<PerfCounters::FlopEvent> flop_events;
+#endif
+
+  // Memory of the serial mesh built in setup() (in bytes; 0 if restarting, and
+  // on the processes that do not build it).
+  std::size_t serial_mesh_memory = 0;
+
+  // Parameters of the stopping criterion (0 disables each of them).
+  struct StoppingCriterion {
+    double change_tolerance = 0.0;
+    double min_threshold    = 0.0;
+    double mass_fraction    = 0.0;
+  } stopping;
+
+  // Volume of the domain (computed together with the mass).
+  double domain_volume = 0.0;
+
   const std::vector<double> axon_direction = {1, 1, 1};
 
   const double d_ext = 5;
@@ -188,7 +603,42 @@ protected:
   const unsigned int r;
 
   // Time step.
-  const double deltat;
+  double deltat;
+
+  // Previous time step.
+  double deltat_old;
+
+  // Parameters of the adaptive time step selection.
+  struct AdaptiveTimeStepping {
+    bool enabled = false;
+
+    double min_deltat = 0.0;
+    double max_deltat = 0.0;
+
+    // Tolerance on the estimated local error.
+    double tolerance = 0.0;
+
+    // Newton iterations after which the step is rejected.
+    unsigned int max_newton_iterations = 8;
+
+    // Newton iterations above which the step is not allowed to grow.
+    unsigned int target_newton_iterations = 4;
+  } adaptive;
+
+  // Time discretization scheme.
+  TimeScheme time_scheme = TimeScheme::BackwardEuler;
+
+  // Preconditioner of the Newton linear systems.
+  Preconditioner preconditioner = Preconditioner::SSOR;
+
+  // Parameter of the theta method.
+  double theta = 0.5;
+
+  // Coefficients of the current step: the time derivative is approximated as
+  // (a[0] u_{n+1} + a[1] u_n + a[2] u_{n-1}) / deltat, and the right-hand side
+  // f as theta_step f(u_{n+1}) + (1 - theta_step) f(u_n).
+  std::array<double, 3> time_coefficients = {{1.0, -1.0, 0.0}};
+  double                theta_step        = 1.0;
 
   // Mesh.
   parallel::fullydistributed::Triangulation<dim> mesh;
@@ -208,9 +658,74 @@ protected:
   // DoFs relevant to the current process (including ghost DoFs).
   IndexSet locally_relevant_dofs;
 
+  // Locally owned cells: first the interior ones, whose DoFs are all locally
+  // owned, then those with ghost DoFs.
+  std::vector<DoFHandler<dim>::active_cell_iterator> owned_cells;
+  unsigned int                                       n_interior_cells = 0;
+
+  // Ghost exchange of the solution (see start_ghost_update()).
+  std::shared_ptr<const Utilities::MPI::Partitioner> ghost_partitioner;
+
+  // Position in the local storage of the solution of each locally owned DoF
+  // and of each ghost DoF (in the order of the partitioner).
+  std::vector<int> owned_local_indices;
+  std::vector<int> ghost_local_indices;
+
+  // Buffers and requests of the pending ghost exchange, if any.
+  std::vector<double>      ghost_import_buffer;
+  std::vector<double>      ghost_values;
+  std::vector<MPI_Request> ghost_requests;
+  bool                     ghost_update_pending = false;
+
   // Jacobian matrix.
   TrilinosWrappers::SparseMatrix jacobian_matrix;
 
+  // Mass matrix, stiffness matrix and diffusion matrix M / deltat + K. They
+  // are only initialized if needed by the time discretization.
+  TrilinosWrappers::SparseMatrix mass_matrix;
+  TrilinosWrappers::SparseMatrix stiffness_matrix;
+  TrilinosWrappers::SparseMatrix diffusion_matrix;
+
+  // Preconditioner for the diffusion matrix, built once per time step size.
+  TrilinosWrappers::PreconditionAMG diffusion_preconditioner;
+
+  // Time step for which the diffusion matrix was built (0 if it was not).
+  double diffusion_deltat = 0.0;
+
+  // Nodal values of alpha.
+  TrilinosWrappers::MPI::Vector alpha_owned;
+
+  // Whether the mass matrix is lumped.
+  bool mass_lumping = false;
+
+  // Lumped mass matrix (diagonal) and its inverse.
+  TrilinosWrappers::MPI::Vector lumped_mass;
+  TrilinosWrappers::MPI::Vector inverse_lumped_mass;
+
+  // Constant part of the Jacobian with lumped mass, its preconditioner, and the
+  // coefficients a[0] / deltat and theta it was built with.
+  TrilinosWrappers::SparseMatrix    lumped_matrix;
+  TrilinosWrappers::PreconditionAMG lumped_preconditioner;
+  std::array<double, 2>             lumped_matrix_coefficients = {{0.0, 0.0}};
+
+  // Diagonal of lumped_matrix, to which the reaction term is added on the
+  // diagonal of the Jacobian, and work vector of the lumped assembly.
+  TrilinosWrappers::MPI::Vector lumped_diagonal;
+  TrilinosWrappers::MPI::Vector lumped_tmp;
+
+  // Locally owned copies of solution_old and solution_older, updated once per
+  // time step (with lumped mass only).
+  TrilinosWrappers::MPI::Vector solution_old_owned;
+  TrilinosWrappers::MPI::Vector solution_older_owned;
+
+  // Krylov basis for the exponential integrator.
+  std::vector<TrilinosWrappers::MPI::Vector> krylov_basis;
+
+  // Maximum dimension of the Krylov subspace and relative tolerance on the
+  // error of the phi_1 approximation.
+  const unsigned int krylov_max_dimension = 30;
+  const double       krylov_tolerance     = 1e-7;
+
   // Residual vector.
   TrilinosWrappers::MPI::Vector residual_vector;
 
@@ -226,7 +741,73 @@ protected:
   // System solution at previous time step.
   TrilinosWrappers::MPI::Vector solution_old;
 
+  // System solution two time steps before. It is rotated with solution_old
+  // through swap(), so that no ghosted vector is copied to keep it.
+  TrilinosWrappers::MPI::Vector solution_older;
+
   TimerOutput timer;
+
+  // Telemetry. ////////////////////////////////////////////////////////////////
+
+  // Counters and wall times (in seconds) collected while solving.
+  struct SolverStats {
+    unsigned int newton_iterations   = 0;
+    unsigned int linear_iterations   = 0;
+    double       residual_norm       = 0.0;
+    double       assemble_time       = 0.0;
+    double       preconditioner_time = 0.0;
+    double       linear_solve_time   = 0.0;
+    double       ghost_update_time   = 0.0;
+  };
+
+  // Write one telemetry record (only on rank 0, if telemetry is enabled),
+  // for a step of the given size.
+  void
+  write_telemetry(const std::string  &kind,
+                  const unsigned int &time_step,
+                  const unsigned int &newton_iteration,
+                  const SolverStats  &stats,
+                  const double       &wall_time,
+                  const double       &step_size);
+
+  // Statistics of the last linear solve.
+  SolverStats linear_stats;
+
+  // Statistics accumulated over the Newton iterations of the current time step.
+  SolverStats step_stats;
+
+  // Current time step index.
+  unsigned int time_step = 0;
+
+  // Index of the next output file.
+  unsigned int tt = 0;
+
+  // Telemetry stream (open only on rank 0).
+  std::ofstream telemetry;
+
+  // Diagnostics stream (open only on rank 0), and whether diagnostics are
+  // enabled (on all ranks).
+  std::ofstream diagnostics;
+  bool          diagnostics_enabled = false;
+
+  // Threshold of u defining the affected volume and the front.
+  double diagnostics_threshold = 0.5;
+
+  // Probe points, and output stream of the sampled values (open only on
+  // rank 0).
+  std::vector<Point<dim>> probe_points;
+  std::ofstream           probes;
+
+  // Probe located in a locally owned cell: u at the probe is the sum of the
+  // values at the given DoFs, weighted by the shape functions at the probe.
+  struct Probe {
+    unsigned int                         index;
+    std::vector<types::global_dof_index> dof_indices;
+    std::vector<double>                  shape_values;
+  };
+
+  // Probes located on this process.
+  std::vector<Probe> local_probes;
 };
 
 #endif
@@ -0,0 +1,328 @@
+#include "PrionEnsemble.hpp"
+
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_Operator.h>
+
+void
+HeatNonLinearEnsemble::setup() {
+  HeatNonLinear::setup();
+
+  pcout << "-----------------------------------------------" << std::endl;
+
+  pcout << "Initializing the ensemble of " << members.size() << " members" << std::endl;
+
+  member_solution_owned.resize(members.size());
+  member_solution.resize(members.size());
+  member_solution_old.resize(members.size());
+  member_residual.resize(members.size());
+  member_delta.resize(members.size());
+
+    for (unsigned int k = 0; k < members.size(); ++k) {
+      member_solution_owned[k].reinit(locally_owned_dofs, mpi_comm);
+      member_residual[k].reinit(locally_owned_dofs, mpi_comm);
+      member_delta[k].reinit(locally_owned_dofs, mpi_comm);
+
+      member_solution[k].reinit(locally_owned_dofs, locally_relevant_dofs, mpi_comm);
+      member_solution_old[k] = member_solution[k];
+    }
+
+  // The matrix of the modified Newton method, shared by all the members.
+  update_diffusion_matrix();
+}
+
+Epetra_MultiVector
+HeatNonLinearEnsemble::view(std::vector<TrilinosWrappers::MPI::Vector> &vectors) const {
+  std::vector<double *> pointers(vectors.size());
+  for (unsigned int k = 0; k < vectors.size(); ++k)
+    pointers[k] = vectors[k].begin();
+
+  return Epetra_MultiVector(View,
+                            vectors[0].trilinos_partitioner(),
+                            pointers.data(),
+                            static_cast<int>(vectors.size()));
+}
+
+void
+HeatNonLinearEnsemble::assemble_residuals() {
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q           = quadrature->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients | update_JxW_values);
+
+  Vector<double> cell_residual(dofs_per_cell);
+
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
+
+  for (auto &residual : member_residual)
+    residual = 0.0;
+
+  // Value and gradient of the solution, and value of the solution at previous
+  // timestep, on current cell.
+  std::vector<double>         solution_loc(n_q);
+  std::vector<Tensor<1, dim>> solution_gradient_loc(n_q);
+  std::vector<double>         solution_old_loc(n_q);
+
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
+
+      // The geometric data are computed once for all the members.
+      fe_values.reinit(cell);
+      cell->get_dof_indices(dof_indices);
+
+        for (unsigned int k = 0; k < members.size(); ++k) {
+          const double alpha_loc = members[k].alpha;
+
+          cell_residual = 0.0;
+
+          fe_values.get_function_values(member_solution[k], solution_loc);
+          fe_values.get_function_gradients(member_solution[k], solution_gradient_loc);
+          fe_values.get_function_values(member_solution_old[k], solution_old_loc);
+
+            for (unsigned int q = 0; q < n_q; ++q) {
+                for (unsigned int i = 0; i < dofs_per_cell; ++i) {
+                  // Time derivative term.
+                  cell_residual(i) -= fe_values.shape_value(i, q) *
+                                      (solution_loc[q] - solution_old_loc[q]) / deltat *
+                                      fe_values.JxW(q);
+
+                  // Diffusion term.
+                  cell_residual(i) -= fe_values.shape_grad(i, q) * D *
+                                      solution_gradient_loc[q] * fe_values.JxW(q);
+
+                  // Reaction term.
+                  cell_residual(i) += fe_values.shape_value(i, q) * alpha_loc *
+                                      solution_loc[q] * (1 - solution_loc[q]) *
+                                      fe_values.JxW(q);
+                }
+            }
+
+          member_residual[k].add(dof_indices, cell_residual);
+        }
+    }
+
+  for (auto &residual : member_residual)
+    residual.compress(VectorOperation::add);
+}
+
+void
+HeatNonLinearEnsemble::solve_linear_systems() {
+  const int n_members = members.size();
+
+  Epetra_MultiVector      B   = view(member_residual);
+  Epetra_MultiVector      X   = view(member_delta);
+  const Epetra_CrsMatrix &A   = diffusion_matrix.trilinos_matrix();
+  const Epetra_Operator  &P   = diffusion_preconditioner.trilinos_operator();
+  const Epetra_BlockMap  &map = B.Map();
+
+  // CG iterations run simultaneously for all the members: each member has its
+  // own coefficients, but matrix and preconditioner are applied at once to all
+  // the search directions. Members that have converged are frozen.
+  Epetra_MultiVector R(B);
+  Epetra_MultiVector Z(map, n_members);
+  Epetra_MultiVector S(map, n_members);
+  Epetra_MultiVector Q(map, n_members);
+
+  std::vector<double> tolerance(n_members);
+  std::vector<double> residual_norm(n_members);
+  std::vector<double> rz(n_members);
+  std::vector<double> rz_new(n_members);
+  std::vector<double> sq(n_members);
+  std::vector<bool>   converged(n_members, false);
+
+  B.Norm2(tolerance.data());
+  for (auto &tol : tolerance)
+    tol *= 1e-6;
+
+  X.PutScalar(0.0);
+
+  int ierr = P.ApplyInverse(R, Z);
+  AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+  S = Z;
+  R.Dot(Z, rz.data());
+
+  unsigned int n_iter = 0;
+
+    for (; n_iter < 1000; ++n_iter) {
+      R.Norm2(residual_norm.data());
+
+      bool all_converged = true;
+        for (int k = 0; k < n_members; ++k) {
+          converged[k]  = residual_norm[k] <= tolerance[k];
+          all_converged = all_converged && converged[k];
+        }
+
+      if (all_converged)
+        break;
+
+      ierr = A.Multiply(false, S, Q);
+      AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+      S.Dot(Q, sq.data());
+
+        for (int k = 0; k < n_members; ++k) {
+          const double alpha_cg = converged[k] ? 0.0 : rz[k] / sq[k];
+          X(k)->Update(alpha_cg, *S(k), 1.0);
+          R(k)->Update(-alpha_cg, *Q(k), 1.0);
+        }
+
+      ierr = P.ApplyInverse(R, Z);
+      AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+      R.Dot(Z, rz_new.data());
+
+        for (int k = 0; k < n_members; ++k) {
+          const double beta_cg = converged[k] ? 0.0 : rz_new[k] / rz[k];
+          S(k)->Update(1.0, *Z(k), beta_cg);
+          rz[k] = rz_new[k];
+        }
+    }
+
+  AssertThrow(n_iter < 1000, ExcMessage("Block CG did not converge."));
+
+  linear_stats.linear_iterations = n_iter;
+  pcout << "  " << n_iter << " block CG iterations" << std::endl;
+}
+
+void
+HeatNonLinearEnsemble::solve_newton_ensemble() {
+  const unsigned int n_max_iters        = 100;
+  const double       residual_tolerance = 1e-10;
+
+  unsigned int n_iter        = 0;
+  double       residual_norm = residual_tolerance + 1;
+
+  // Residual norm of each member, at the last iteration.
+  std::vector<double> member_residual_norm(members.size(), 0.0);
+
+    while (n_iter < n_max_iters && residual_norm > residual_tolerance) {
+      Timer iteration_watch;
+      Timer stopwatch;
+
+      linear_stats = SolverStats();
+
+      timer.enter_subsection("Assemble system");
+      assemble_residuals();
+      timer.leave_subsection();
+      linear_stats.assemble_time = stopwatch.wall_time();
+
+      residual_norm = 0.0;
+        for (unsigned int k = 0; k < members.size(); ++k) {
+          member_residual_norm[k] = member_residual[k].l2_norm();
+          residual_norm           = std::max(residual_norm, member_residual_norm[k]);
+        }
+      linear_stats.residual_norm = residual_norm;
+
+      pcout << "  Newton iteration " << n_iter << "/" << n_max_iters
+            << " - max ||r|| = " << std::scientific << std::setprecision(6)
+            << residual_norm << std::flush;
+
+        if (residual_norm > residual_tolerance) {
+          stopwatch.restart();
+          timer.enter_subsection("Solve system");
+          solve_linear_systems();
+          timer.leave_subsection();
+          linear_stats.linear_solve_time = stopwatch.wall_time();
+
+          stopwatch.restart();
+            for (unsigned int k = 0; k < members.size(); ++k) {
+              member_solution_owned[k] += member_delta[k];
+              member_solution[k] = member_solution_owned[k];
+            }
+          linear_stats.ghost_update_time = stopwatch.wall_time();
+        } else {
+          pcout << " < tolerance" << std::endl;
+        }
+
+      write_telemetry("newton",
+                      time_step,
+                      n_iter,
+                      linear_stats,
+                      iteration_watch.wall_time(),
+                      deltat);
+
+      ++n_iter;
+    }
+
+  // If the iterations stopped on their maximum number, the members whose
+  // residual was still above the tolerance (or not finite) have not converged.
+  std::string not_converged;
+  for (unsigned int k = 0; k < members.size(); ++k)
+    if (!(member_residual_norm[k] <= residual_tolerance))
+      not_converged += " " + std::to_string(k);
+
+  AssertThrow(not_converged.empty(),
+              ExcMessage("Newton's method did not converge in " +
+                         std::to_string(n_max_iters) + " iterations for the members" +
+                         not_converged + "."));
+}
+
+void
+HeatNonLinearEnsemble::output_masses() {
+  const unsigned int n_q = quadrature->size();
+
+  FEValues<dim> fe_values(*fe, *quadrature, update_values | update_JxW_values);
+
+  std::vector<double> solution_loc(n_q);
+  std::vector<double> mass(members.size(), 0.0);
+
+    for (const auto &cell : dof_handler.active_cell_iterators()) {
+      if (!cell->is_locally_owned())
+        continue;
+
+      fe_values.reinit(cell);
+
+        for (unsigned int k = 0; k < members.size(); ++k) {
+          fe_values.get_function_values(member_solution[k], solution_loc);
+          for (unsigned int q = 0; q < n_q; ++q)
+            mass[k] += solution_loc[q] * fe_values.JxW(q);
+        }
+    }
+
+  Utilities::MPI::sum(mass, mpi_comm, mass);
+
+  pcout << "  mass:" << std::scientific << std::setprecision(6);
+  for (const double &m : mass)
+    pcout << " " << m;
+  pcout << std::endl;
+}
+
+void
+HeatNonLinearEnsemble::solve() {
+  pcout << "===============================================" << std::endl;
+
+  // Apply the initial conditions.
+  {
+    pcout << "Applying the initial conditions" << std::endl;
+
+      for (unsigned int k = 0; k < members.size(); ++k) {
+        VectorTools::interpolate(dof_handler, members[k].u_0, member_solution_owned[k]);
+        member_solution[k] = member_solution_owned[k];
+      }
+
+    output_masses();
+    pcout << "-----------------------------------------------" << std::endl;
+  }
+
+  time      = 0.0;
+  time_step = 0;
+
+    while (time < T - 0.5 * deltat) {
+      time += deltat;
+      ++time_step;
+
+      // Store the old solutions, so that they are available for assembly.
+      for (unsigned int k = 0; k < members.size(); ++k)
+        member_solution_old[k] = member_solution[k];
+
+      pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
+            << std::fixed << time << std::endl;
+
+      solve_newton_ensemble();
+
+      if (output_frequency > 0 && !(time_step % output_frequency))
+        output_masses();
+
+      pcout << std::endl;
+    }
+}
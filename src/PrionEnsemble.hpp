@@ -0,0 +1,77 @@
+#ifndef PRION_ENSEMBLE_HPP
+#define PRION_ENSEMBLE_HPP
+
+#include "Prion.hpp"
+
+#include <Epetra_MultiVector.h>
+
+// Class representing an ensemble of non-linear diffusion problems, that differ
+// only in the initial seed and in the (constant) coefficient alpha. All the
+// members share the mesh, the DoF handler, the sparsity pattern and the
+// geometric data, and are advanced together with backward Euler.
+//
+// The non-linear problems are solved with a modified Newton method, whose
+// matrix is the constant M / deltat + K shared by all the members (the
+// reaction term is only in the residual). Then, the residuals of all the
+// members are assembled in a single loop over the cells, and the linear
+// systems are solved simultaneously by a CG method on multi-vectors, so that
+// the matrix and the preconditioner are read once for all the members.
+class HeatNonLinearEnsemble : public HeatNonLinear {
+public:
+  // Parameters of an ensemble member.
+  struct Member {
+    FunctionU0 u_0;
+    double     alpha;
+  };
+
+  // Constructor.
+  HeatNonLinearEnsemble(const unsigned int        &N_,
+                        const unsigned int        &r_,
+                        const double              &T_,
+                        const double              &deltat_,
+                        const std::vector<Member> &members_,
+                        const MPI_Comm            &mpi_comm_ = MPI_COMM_WORLD) :
+    HeatNonLinear(N_, r_, T_, deltat_, mpi_comm_), members(members_) {}
+
+  // Initialization.
+  void
+  setup();
+
+  // Solve the problems.
+  void
+  solve();
+
+protected:
+  // Assemble the residuals of all the members.
+  void
+  assemble_residuals();
+
+  // Solve the linear systems of all the members with the shared matrix.
+  void
+  solve_linear_systems();
+
+  // Solve all the problems for one time step using the modified Newton method.
+  void
+  solve_newton_ensemble();
+
+  // Print the mass of each member.
+  void
+  output_masses();
+
+  // Multi-vector viewing the given vectors (without copying them).
+  Epetra_MultiVector
+  view(std::vector<TrilinosWrappers::MPI::Vector> &vectors) const;
+
+  // Ensemble members.
+  const std::vector<Member> members;
+
+  // Solutions (without and with ghost elements), solutions at the previous time
+  // step, residuals and increments of each member.
+  std::vector<TrilinosWrappers::MPI::Vector> member_solution_owned;
+  std::vector<TrilinosWrappers::MPI::Vector> member_solution;
+  std::vector<TrilinosWrappers::MPI::Vector> member_solution_old;
+  std::vector<TrilinosWrappers::MPI::Vector> member_residual;
+  std::vector<TrilinosWrappers::MPI::Vector> member_delta;
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include "SolutionWriter.hpp"
+
+#include <deal.II/base/exceptions.h>
+#include <deal.II/base/utilities.h>
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+
+namespace {
+  // Identifier of the H5Z-ZFP filter, and its mode with absolute error bound.
+  constexpr H5Z_filter_t zfp_filter_id     = 32013;
+  constexpr unsigned int zfp_mode_accuracy = 3;
+
+  // Write a dataset with the given number of rows and columns, and creation
+  // properties, to an HDF5 file opened for parallel access: this process
+  // writes local_rows rows from the given first row. Returns the number of
+  // bytes stored in the file. Collective.
+  hsize_t
+  write_dataset(const hid_t       &file,
+                const std::string &name,
+                const hid_t       &type,
+                const hsize_t     &rows,
+                const hsize_t     &columns,
+                const hsize_t     &first_row,
+                const hsize_t     &local_rows,
+                const hid_t       &properties,
+                const void        *data) {
+    const hsize_t dimensions[2] = {rows, columns};
+    const hsize_t start[2]      = {first_row, 0};
+    const hsize_t count[2]      = {local_rows, columns};
+
+    const hid_t file_space   = H5Screate_simple(2, dimensions, nullptr);
+    const hid_t memory_space = H5Screate_simple(2, count, nullptr);
+    const hid_t dataset      = H5Dcreate2(
+      file, name.c_str(), type, file_space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    AssertThrow(dataset >= 0, ExcMessage("Could not create the dataset " + name));
+
+      if (local_rows > 0) {
+        H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+      } else {
+        H5Sselect_none(file_space);
+        H5Sselect_none(memory_space);
+      }
+
+    // Filtered datasets can only be written collectively.
+    const hid_t transfer = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(transfer, H5FD_MPIO_COLLECTIVE);
+
+    const herr_t status =
+      H5Dwrite(dataset, type, memory_space, file_space, transfer, data);
+    AssertThrow(status >= 0, ExcMessage("Could not write the dataset " + name));
+
+    const hsize_t stored_bytes = H5Dget_storage_size(dataset);
+
+    H5Pclose(transfer);
+    H5Dclose(dataset);
+    H5Sclose(memory_space);
+    H5Sclose(file_space);
+    H5Pclose(properties);
+
+    return stored_bytes;
+  }
+
+  // Properties of a file opened for parallel access on the given communicator.
+  hid_t
+  parallel_access(const MPI_Comm &mpi_comm) {
+    const hid_t properties = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(properties, mpi_comm, MPI_INFO_NULL);
+    return properties;
+  }
+
+  // XDMF name of the cells with the given number of nodes.
+  std::string
+  topology_type(const unsigned int &nodes_per_cell) {
+    switch (nodes_per_cell) {
+      case 4:
+        return "Tetrahedron";
+      case 8:
+        return "Hexahedron";
+      default:
+        AssertThrow(false, ExcMessage("Unsupported cell type."));
+        return "";
+    }
+  }
+} // namespace
+
+SolutionWriter::SolutionWriter(const MPI_Comm    &mpi_comm_,
+                               const std::string &directory_,
+                               const bool        &asynchronous_) :
+  mpi_comm(mpi_comm_),
+  mpi_rank(Utilities::MPI::this_mpi_process(mpi_comm)),
+  directory(directory_),
+  asynchronous(asynchronous_) {}
+
+SolutionWriter::~SolutionWriter() {
+  if (file >= 0)
+    H5Fclose(file);
+}
+
+void
+SolutionWriter::set_compression(const Compression  &compression_,
+                                const double       &tolerance_,
+                                const unsigned int &deflate_level_) {
+  compression   = compression_;
+  tolerance     = tolerance_;
+  deflate_level = deflate_level_;
+
+    // All the processes write, so the filter must be available on all of them.
+    if (compression == Compression::ZFP) {
+      const unsigned int available =
+        Utilities::MPI::min(H5Zfilter_avail(zfp_filter_id) > 0 ? 1u : 0u, mpi_comm);
+      AssertThrow(available,
+                  ExcMessage("The H5Z-ZFP filter is not available: check that "
+                             "HDF5_PLUGIN_PATH points to the filter plugin."));
+    }
+}
+
+std::int64_t
+SolutionWriter::dataset_properties(const std::size_t &rows,
+                                   const std::size_t &columns,
+                                   const bool        &lossy) const {
+  const hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+
+  // Filters need chunked datasets.
+  if (compression == Compression::None || rows == 0)
+    return properties;
+
+  const hsize_t chunk[2] = {std::min(rows, chunk_rows), columns};
+  H5Pset_chunk(properties, 2, chunk);
+
+    if (lossy && compression == Compression::ZFP) {
+      // The error bound is passed as a double in the last two values.
+      unsigned int cd_values[4] = {zfp_mode_accuracy, 0, 0, 0};
+      std::memcpy(&cd_values[2], &tolerance, sizeof(double));
+      H5Pset_filter(properties, zfp_filter_id, H5Z_FLAG_MANDATORY, 4, cd_values);
+    } else {
+      H5Pset_shuffle(properties);
+      H5Pset_deflate(properties, deflate_level);
+    }
+
+  return properties;
+}
+
+void
+SolutionWriter::set_restart(const unsigned int &n_outputs) {
+  restart           = true;
+  restart_n_outputs = n_outputs;
+}
+
+void
+SolutionWriter::set_mesh(const std::vector<double>       &local_nodes,
+                         const std::vector<unsigned int> &local_cells,
+                         const unsigned int              &nodes_per_cell_) {
+  // Processes without cells do not know the cell type.
+  nodes_per_cell = Utilities::MPI::max(nodes_per_cell_, mpi_comm);
+
+  // Rows of the nodes and cells of this process, their first rows, and their
+  // total numbers.
+  std::uint64_t local_sizes[2] = {local_nodes.size() / dim, 0};
+  if (nodes_per_cell > 0)
+    local_sizes[1] = local_cells.size() / nodes_per_cell;
+
+  std::uint64_t offsets[2] = {0, 0};
+  std::uint64_t sizes[2]   = {0, 0};
+  MPI_Exscan(local_sizes, offsets, 2, MPI_UINT64_T, MPI_SUM, mpi_comm);
+  MPI_Allreduce(local_sizes, sizes, 2, MPI_UINT64_T, MPI_SUM, mpi_comm);
+  if (mpi_rank == 0)
+    offsets[0] = offsets[1] = 0;
+
+  n_local_nodes = local_sizes[0];
+  node_offset   = offsets[0];
+  n_nodes       = sizes[0];
+  n_cells       = sizes[1];
+
+  // Cells must refer to the shared nodes, so that each output holds a single
+  // value per node.
+  const unsigned int valid =
+    std::all_of(local_cells.begin(), local_cells.end(), [this](const unsigned int &node) {
+      return node < n_nodes;
+    });
+  AssertThrow(Utilities::MPI::min(valid, mpi_comm),
+              ExcMessage("The output cells refer to nodes that do not exist."));
+
+  const std::string file_name = directory + "/solution.h5";
+  const hid_t       access    = parallel_access(mpi_comm);
+
+    // After a restart, the existing file is opened, and the outputs to keep
+    // are listed from the time attribute of their datasets. Otherwise, the
+    // file is created, and the mesh written.
+    if (restart) {
+      file = H5Fopen(file_name.c_str(), H5F_ACC_RDWR, access);
+      H5Pclose(access);
+      AssertThrow(file >= 0, ExcMessage("Could not open the file solution.h5"));
+
+        for (unsigned int i = 0; i < restart_n_outputs; ++i) {
+          const std::string name = "u-" + Utilities::int_to_string(i, 4);
+          if (H5Lexists(file, name.c_str(), H5P_DEFAULT) <= 0)
+            continue;
+
+          double      output_time = 0.0;
+          const hid_t attribute   = H5Aopen_by_name(
+            file, name.c_str(), "time", H5P_DEFAULT, H5P_DEFAULT);
+          AssertThrow(attribute >= 0, ExcMessage("Could not read the time of " + name));
+          H5Aread(attribute, H5T_NATIVE_DOUBLE, &output_time);
+          H5Aclose(attribute);
+
+          snapshots.emplace_back(i, output_time);
+        }
+    } else {
+      file = H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, access);
+      H5Pclose(access);
+      AssertThrow(file >= 0, ExcMessage("Could not create the file solution.h5"));
+
+      write_dataset(file,
+                    "nodes",
+                    H5T_NATIVE_DOUBLE,
+                    n_nodes,
+                    dim,
+                    offsets[0],
+                    local_sizes[0],
+                    dataset_properties(n_nodes, dim, false),
+                    local_nodes.data());
+      write_dataset(file,
+                    "cells",
+                    H5T_NATIVE_UINT,
+                    n_cells,
+                    nodes_per_cell,
+                    offsets[1],
+                    local_sizes[1],
+                    dataset_properties(n_cells, nodes_per_cell, false),
+                    local_cells.data());
+    }
+}
+
+void
+SolutionWriter::write(const std::vector<double> &local_values,
+                      const unsigned int        &index,
+                      const double              &time) {
+  const unsigned int valid = local_values.size() == n_local_nodes;
+  AssertThrow(Utilities::MPI::min(valid, mpi_comm),
+              ExcMessage("The output must have one value per node of the mesh."));
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // An output written after the checkpoint of a restart is replaced.
+  const std::string name = "u-" + Utilities::int_to_string(index, 4);
+  if (H5Lexists(file, name.c_str(), H5P_DEFAULT) > 0)
+    H5Ldelete(file, name.c_str(), H5P_DEFAULT);
+
+  const hsize_t stored_bytes = write_dataset(file,
+                                             name,
+                                             H5T_NATIVE_DOUBLE,
+                                             n_nodes,
+                                             1,
+                                             node_offset,
+                                             n_local_nodes,
+                                             dataset_properties(n_nodes, 1, true),
+                                             local_values.data());
+
+  // The time is stored with the values, to rebuild the XDMF file on restart.
+  const hid_t scalar    = H5Screate(H5S_SCALAR);
+  const hid_t attribute = H5Acreate_by_name(file,
+                                            name.c_str(),
+                                            "time",
+                                            H5T_NATIVE_DOUBLE,
+                                            scalar,
+                                            H5P_DEFAULT,
+                                            H5P_DEFAULT,
+                                            H5P_DEFAULT);
+  H5Awrite(attribute, H5T_NATIVE_DOUBLE, &time);
+  H5Aclose(attribute);
+  H5Sclose(scalar);
+
+  // Flush, so that the file is readable while the run goes on, unless it is
+  // deferred.
+  if (!asynchronous)
+    flush();
+
+  const double output_time =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  statistics.push_back({index, time, n_nodes * sizeof(double), stored_bytes, output_time});
+
+  snapshots.emplace_back(index, time);
+  write_xdmf();
+
+  write_time += output_time;
+}
+
+void
+SolutionWriter::flush() {
+  if (file >= 0)
+    H5Fflush(file, H5F_SCOPE_LOCAL);
+}
+
+void
+SolutionWriter::write_xdmf() const {
+  std::exception_ptr exception;
+
+    if (mpi_rank == 0) {
+      try {
+        write_xdmf_file();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    }
+
+  // The error, if any, is thrown on every process, so that none of them goes
+  // on to the next collective call.
+  int ok = exception ? 0 : 1;
+  MPI_Bcast(&ok, 1, MPI_INT, 0, mpi_comm);
+
+  if (exception)
+    std::rethrow_exception(exception);
+
+  AssertThrow(ok, ExcMessage("The file solution.xdmf could not be written."));
+}
+
+void
+SolutionWriter::write_xdmf_file() const {
+  std::ofstream xdmf(directory + "/solution.xdmf");
+  AssertThrow(xdmf, ExcMessage("Could not create the file solution.xdmf"));
+
+  xdmf << "<?xml version=\"1.0\" ?>\n"
+       << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n"
+       << "<Xdmf Version=\"2.0\">\n"
+       << "  <Domain>\n"
+       << "    <Grid Name=\"solution\" GridType=\"Collection\" "
+       << "CollectionType=\"Temporal\">\n";
+
+    for (const auto &[index, time] : snapshots) {
+      xdmf << "      <Grid Name=\"mesh\" GridType=\"Uniform\">\n"
+           << "        <Time Value=\"" << time << "\"/>\n"
+           << "        <Topology TopologyType=\"" << topology_type(nodes_per_cell)
+           << "\" NumberOfElements=\"" << n_cells << "\">\n"
+           << "          <DataItem Dimensions=\"" << n_cells << " " << nodes_per_cell
+           << "\" NumberType=\"UInt\" Format=\"HDF\">solution.h5:/cells</DataItem>\n"
+           << "        </Topology>\n"
+           << "        <Geometry GeometryType=\"XYZ\">\n"
+           << "          <DataItem Dimensions=\"" << n_nodes << " " << dim
+           << "\" NumberType=\"Float\" Precision=\"8\" "
+           << "Format=\"HDF\">solution.h5:/nodes</DataItem>\n"
+           << "        </Geometry>\n"
+           << "        <Attribute Name=\"u\" AttributeType=\"Scalar\" Center=\"Node\">\n"
+           << "          <DataItem Dimensions=\"" << n_nodes
+           << " 1\" NumberType=\"Float\" Precision=\"8\" Format=\"HDF\">solution.h5:/u-"
+           << Utilities::int_to_string(index, 4) << "</DataItem>\n"
+           << "        </Attribute>\n"
+           << "      </Grid>\n";
+    }
+
+  xdmf << "    </Grid>\n"
+       << "  </Domain>\n"
+       << "</Xdmf>\n";
+}
@@ -0,0 +1,167 @@
+#ifndef SOLUTION_WRITER_HPP
+#define SOLUTION_WRITER_HPP
+
+#include <deal.II/base/mpi.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dealii;
+
+// Writer of a time series of nodal fields to an HDF5 file, with an XDMF
+// temporal collection for visualization. The mesh is written once, and each
+// output only adds a dataset with the field values to the same file (one
+// value per node, the nodes being shared by the cells); the XDMF file is
+// rewritten with one more entry.
+//
+// Every process writes its own rows of the datasets with parallel HDF5
+// (MPI-IO), so that none of them holds more than its part of the mesh and of
+// the values. If the output is asynchronous, the file is not flushed after
+// each output, which would wait for the data to reach the storage: the flush
+// is deferred to the next call to flush().
+class SolutionWriter {
+public:
+  // Physical dimension.
+  static constexpr unsigned int dim = 3;
+
+  // Compression of the datasets. Deflate (with byte shuffling) is lossless.
+  // ZFP is lossy, with an absolute error bound, and needs the H5Z-ZFP filter
+  // plugin (found through HDF5_PLUGIN_PATH); it only applies to the field
+  // values, while the mesh is compressed with deflate.
+  enum class Compression { None, Deflate, ZFP };
+
+  // Size and write time of an output.
+  struct Statistics {
+    unsigned int  index;
+    double        time;
+    std::uint64_t raw_bytes;
+    std::uint64_t stored_bytes;
+    double        write_time;
+  };
+
+  // Constructor.
+  SolutionWriter(const MPI_Comm    &mpi_comm_,
+                 const std::string &directory_,
+                 const bool        &asynchronous_);
+
+  // Destructor. Closes the file. Collective.
+  ~SolutionWriter();
+
+  // Set the compression of the datasets. tolerance is the error bound of ZFP,
+  // and the level of deflate (from 1 to 9) is given by deflate_level.
+  // Collective.
+  void
+  set_compression(const Compression  &compression_,
+                  const double       &tolerance_     = 0.0,
+                  const unsigned int &deflate_level_ = 4);
+
+  // Continue the time series of an existing file, keeping its first n_outputs
+  // outputs (the later ones are replaced as they are written again). Call it
+  // before set_mesh().
+  void
+  set_restart(const unsigned int &n_outputs);
+
+  // Set the mesh, given as the nodes and cells of this process, with
+  // nodes_per_cell nodes per cell. The nodes of all the processes are numbered
+  // consecutively in the order of the processes, and cells refer to them with
+  // these global indices (so that cells may use nodes of other processes).
+  // The file is created and the mesh written, or the file of the restart is
+  // opened. Collective.
+  void
+  set_mesh(const std::vector<double>       &local_nodes,
+           const std::vector<unsigned int> &local_cells,
+           const unsigned int              &nodes_per_cell_);
+
+  // Write the field values at the nodes of this process (one per node), as
+  // output number index at the given time. Collective.
+  void
+  write(const std::vector<double> &local_values,
+        const unsigned int        &index,
+        const double              &time);
+
+  // Flush the file, so that the outputs written so far are complete on the
+  // storage. Collective.
+  void
+  flush();
+
+  // Total wall time spent writing files on this process.
+  double
+  get_write_time() const {
+    return write_time;
+  }
+
+  // Statistics of the outputs written so far, with the write times of this
+  // process.
+  const std::vector<Statistics> &
+  get_statistics() const {
+    return statistics;
+  }
+
+protected:
+  // Creation properties of a dataset with the given number of rows and
+  // columns, with the selected compression (lossy only if allowed).
+  std::int64_t
+  dataset_properties(const std::size_t &rows,
+                     const std::size_t &columns,
+                     const bool        &lossy) const;
+
+  // Rewrite the XDMF file on the first process, and throw its errors on all
+  // the processes. Collective.
+  void
+  write_xdmf() const;
+
+  // Rewrite the XDMF file with all the outputs written so far.
+  void
+  write_xdmf_file() const;
+
+  // MPI communicator.
+  const MPI_Comm mpi_comm;
+
+  // This MPI process.
+  const unsigned int mpi_rank;
+
+  // Output directory.
+  const std::string directory;
+
+  // Whether the flush of the file is deferred.
+  const bool asynchronous;
+
+  // Number of nodes of each cell.
+  unsigned int nodes_per_cell = 0;
+
+  // Number of nodes and cells of the mesh.
+  std::size_t n_nodes = 0;
+  std::size_t n_cells = 0;
+
+  // Number of nodes of this process, and index of the first one.
+  std::size_t n_local_nodes = 0;
+  std::size_t node_offset   = 0;
+
+  // HDF5 file identifier (negative until the mesh is set).
+  std::int64_t file = -1;
+
+  // Number of outputs kept from an existing file (if restarting).
+  bool         restart           = false;
+  unsigned int restart_n_outputs = 0;
+
+  // Index and time of the outputs written so far.
+  std::vector<std::pair<unsigned int, double>> snapshots;
+
+  // Compression, ZFP error bound and deflate level.
+  Compression  compression   = Compression::None;
+  double       tolerance     = 0.0;
+  unsigned int deflate_level = 4;
+
+  // Number of rows of a chunk of compressed datasets.
+  static constexpr std::size_t chunk_rows = 65536;
+
+  // Statistics of the outputs written so far.
+  std::vector<Statistics> statistics;
+
+  // Total wall time spent writing files.
+  double write_time = 0.0;
+};
+
+#endif
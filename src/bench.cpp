@@ -0,0 +1,178 @@
+#include "Prion.hpp"
+
+#include <sstream>
+
+// Benchmark of the main kernels of the solver, each timed in isolation for a
+// number of repetitions, on a state close to the first time step: assembly of
+// the tangent problem, assembly of the residual only, solution of the linear
+// system with each preconditioner, ghost update (blocking, and split into the
+// start and finish of the non-blocking exchange), and output.
+//
+// Usage: prion_bench [repetitions] [cube | brain | mesh file] [N] [JSON file]
+// The cube mesh has N + 1 subdivisions per side. If a JSON file is given, the
+// results are also written to it.
+class PrionBench : public HeatNonLinear {
+public:
+  using HeatNonLinear::HeatNonLinear;
+
+  // Run the benchmark.
+  void
+  run(const unsigned int &repetitions, const std::string &json_file_name);
+
+protected:
+  // Time the given kernel (the maximum over the processes, after a barrier).
+  // Returns the times of each repetition.
+  template <typename Kernel>
+  std::vector<double>
+  time_kernel(const unsigned int &repetitions, const Kernel &kernel);
+
+  // Print (and store) median, minimum and maximum time of a kernel, and its
+  // throughput in cells and DoFs per second. For linear solves, the number of
+  // iterations of the last repetition is also stored.
+  void
+  report(const std::string  &name,
+         std::vector<double> times,
+         const int          &linear_iterations = -1);
+
+  // Lines of the JSON report.
+  std::vector<std::string> json_lines;
+};
+
+template <typename Kernel>
+std::vector<double>
+PrionBench::time_kernel(const unsigned int &repetitions, const Kernel &kernel) {
+  std::vector<double> times;
+
+    for (unsigned int k = 0; k < repetitions; ++k) {
+      MPI_Barrier(mpi_comm);
+      Timer stopwatch;
+      kernel();
+      times.push_back(Utilities::MPI::max(stopwatch.wall_time(), mpi_comm));
+    }
+
+  return times;
+}
+
+void
+PrionBench::report(const std::string  &name,
+                   std::vector<double> times,
+                   const int          &linear_iterations) {
+  std::sort(times.begin(), times.end());
+
+  const double median = times[times.size() / 2];
+  const double cells  = mesh.n_global_active_cells() / median;
+  const double dofs   = dof_handler.n_dofs() / median;
+
+  pcout << "  " << std::left << std::setw(28) << name << std::right << std::scientific
+        << std::setprecision(3) << " median " << median << " s, min " << times.front()
+        << " s, max " << times.back() << " s, " << cells << " cells/s, " << dofs
+        << " DoFs/s" << std::endl;
+
+  std::ostringstream line;
+  line << std::scientific << std::setprecision(6) << "    {\"kernel\": \"" << name
+       << "\", \"median\": " << median << ", \"min\": " << times.front()
+       << ", \"max\": " << times.back() << ", \"cells_per_second\": " << cells
+       << ", \"dofs_per_second\": " << dofs;
+  if (linear_iterations >= 0)
+    line << ", \"linear_iterations\": " << linear_iterations;
+  line << "}";
+  json_lines.push_back(line.str());
+}
+
+void
+PrionBench::run(const unsigned int &repetitions, const std::string &json_file_name) {
+  // State of the first time step: the initial condition as old solution and as
+  // Newton initial guess.
+  apply_initial_condition();
+  solution_old = solution;
+
+  pcout << "===============================================" << std::endl;
+  pcout << "Benchmark: " << repetitions << " repetitions, " << mpi_size
+        << " processes, " << mesh.n_global_active_cells() << " cells, "
+        << dof_handler.n_dofs() << " DoFs" << std::endl;
+
+  report("assemble_system", time_kernel(repetitions, [&]() { assemble_system(); }));
+  report("assemble_residual",
+         time_kernel(repetitions, [&]() { assemble_system(true); }));
+
+  // The linear system is solved from a zero initial guess at every repetition.
+  assemble_system();
+
+  const std::vector<std::pair<Preconditioner, std::string>> preconditioners = {
+    {Preconditioner::SSOR, "solve_linear_system (SSOR)"},
+    {Preconditioner::Jacobi, "solve_linear_system (Jacobi)"},
+    {Preconditioner::AMG, "solve_linear_system (AMG)"}};
+
+    for (const auto &[type, name] : preconditioners) {
+      set_preconditioner(type);
+      const auto times = time_kernel(repetitions, [&]() {
+        delta_owned = 0.0;
+        solve_linear_system();
+      });
+      report(name, times, linear_stats.linear_iterations);
+    }
+
+  report("ghost_update", time_kernel(repetitions, [&]() { solution = solution_owned; }));
+  report("ghost_update (split)", time_kernel(repetitions, [&]() {
+           start_ghost_update();
+           finish_ghost_update();
+         }));
+
+  // Output, including the file write and flush (and, for the first
+  // repetition, the construction and write of the output mesh).
+  set_asynchronous_output(false);
+  report("output", time_kernel(repetitions, [&]() {
+           output(tt++, time, solution);
+           writer->flush();
+         }));
+
+#ifdef PRION_PERF_COUNTERS
+  perf_counters->print(pcout);
+#endif
+
+    if (mpi_rank == 0 && !json_file_name.empty()) {
+      std::ofstream json(json_file_name);
+      AssertThrow(json, ExcMessage("Could not open the file " + json_file_name));
+
+      json << "{\n"
+           << "  \"processes\": " << mpi_size << ",\n"
+           << "  \"cells\": " << mesh.n_global_active_cells() << ",\n"
+           << "  \"dofs\": " << dof_handler.n_dofs() << ",\n"
+           << "  \"repetitions\": " << repetitions << ",\n"
+           << "  \"kernels\": [\n";
+      for (unsigned int i = 0; i < json_lines.size(); ++i)
+        json << json_lines[i] << (i + 1 < json_lines.size() ? ",\n" : "\n");
+      json << "  ]\n"
+           << "}\n";
+    }
+}
+
+int
+main(int argc, char *argv[]) {
+  Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv);
+
+  const unsigned int repetitions = argc > 1 ? std::stoi(argv[1]) : 10;
+  const std::string  mesh        = argc > 2 ? argv[2] : "cube";
+  const unsigned int N           = argc > 3 ? std::stoi(argv[3]) : 19;
+  const std::string  json_file   = argc > 4 ? argv[4] : "";
+
+  const unsigned int degree = 1;
+  const double       T      = 1.0;
+  const double       deltat = 0.1;
+
+  PrionBench bench(N, degree, T, deltat);
+
+    if (mesh == "cube") {
+      bench.set_mesh_file("");
+      bench.set_initial_condition(
+        HeatNonLinear::FunctionU0(Point<HeatNonLinear::dim>(0.5, 0.5, 0.5), 0.1, 0.1, 30));
+    } else if (mesh != "brain") {
+      bench.set_mesh_file(mesh);
+    }
+
+  bench.set_output_directory(".");
+  bench.setup();
+  bench.run(repetitions, json_file);
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include "Prion.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <tuple>
+
+// Convergence study in time: the problem is solved on the cube mesh with
+// decreasing time steps, and the solution at the final time is compared with
+// a reference solution computed with a much smaller step. The estimated order
+// of convergence should be 1 for backward Euler and Strang splitting (whose
+// diffusion step is backward Euler) and 2 for BDF2, Crank-Nicolson and
+// exponential Euler. The wall times allow to compare the schemes at equal
+// accuracy.
+//
+// The order observed between the two smallest steps must be within
+// order_tolerance of the expected one for each scheme; otherwise, the program
+// returns 1, so that it can be used as a test.
+int
+main(int argc, char *argv[]) {
+  Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv);
+
+  const unsigned int mpi_rank = Utilities::MPI::this_mpi_process(MPI_COMM_WORLD);
+  ConditionalOStream pcout(std::cout, mpi_rank == 0);
+
+  const unsigned int N      = 9;
+  const unsigned int degree = 1;
+
+  const double T = 1.0;
+
+  const std::vector<double> deltat_vector = {0.1, 0.05, 0.025, 0.0125};
+  const double              deltat_ref    = 0.1 / 256;
+
+  const double order_tolerance = 0.3;
+
+  const HeatNonLinear::FunctionU0 u_0(Point<HeatNonLinear::dim>(0.5, 0.5, 0.5),
+                                      0.1,
+                                      0.1,
+                                      30);
+
+  // Solve the problem with the given scheme and time step, and return an owned
+  // copy of the final solution together with the wall time of the solve.
+  const auto run = [&](const HeatNonLinear::TimeScheme &scheme, const double &deltat) {
+    HeatNonLinear problem(N, degree, T, deltat);
+
+    problem.set_mesh_file("");
+    problem.set_initial_condition(u_0);
+    problem.set_output_frequency(0);
+    problem.set_time_scheme(scheme);
+
+    problem.setup();
+
+    Timer stopwatch;
+    problem.solve();
+    const double wall_time = stopwatch.wall_time();
+
+    TrilinosWrappers::MPI::Vector result(problem.get_solution().locally_owned_elements(),
+                                         MPI_COMM_WORLD);
+    result = problem.get_solution();
+
+    return std::make_pair(result, wall_time);
+  };
+
+  const TrilinosWrappers::MPI::Vector reference =
+    run(HeatNonLinear::TimeScheme::BDF2, deltat_ref).first;
+
+  // Schemes, with their names and expected orders.
+  const std::vector<std::tuple<HeatNonLinear::TimeScheme, std::string, double>> schemes =
+    {{HeatNonLinear::TimeScheme::BackwardEuler, "Backward Euler", 1.0},
+     {HeatNonLinear::TimeScheme::BDF2, "BDF2", 2.0},
+     {HeatNonLinear::TimeScheme::Theta, "Crank-Nicolson", 2.0},
+     {HeatNonLinear::TimeScheme::StrangSplitting, "Strang splitting", 1.0},
+     {HeatNonLinear::TimeScheme::ExponentialEuler, "Exponential Euler", 2.0}};
+
+  std::vector<std::string> report;
+  bool                     passed = true;
+
+    for (const auto &[scheme, name, expected_order] : schemes) {
+      report.push_back(name);
+
+      double error_old = 0.0;
+      double order     = 0.0;
+
+        for (const double &deltat : deltat_vector) {
+          auto [solution, wall_time] = run(scheme, deltat);
+
+          // Error in the maximum norm of the nodal values.
+          solution -= reference;
+          const double error = solution.linfty_norm();
+
+          std::ostringstream line;
+          line << "  dt = " << std::setw(8) << std::fixed << std::setprecision(5) << deltat
+               << "  error = " << std::scientific << std::setprecision(4) << error;
+            if (error_old > 0.0) {
+              order = std::log(error_old / error) / std::log(2.0);
+              line << "  order = " << std::fixed << std::setprecision(2) << order;
+            }
+          line << "  wall time = " << std::fixed << std::setprecision(2) << wall_time
+               << " s";
+
+          report.push_back(line.str());
+          error_old = error;
+        }
+
+      const bool scheme_passed = std::abs(order - expected_order) <= order_tolerance;
+      passed                   = passed && scheme_passed;
+
+      std::ostringstream line;
+      line << "  expected order " << std::fixed << std::setprecision(1) << expected_order
+           << ": " << (scheme_passed ? "passed" : "FAILED");
+      report.push_back(line.str());
+    }
+
+  pcout << "===============================================" << std::endl;
+  for (const auto &line : report)
+    pcout << line << std::endl;
+
+  return passed ? 0 : 1;
+}
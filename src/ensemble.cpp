@@ -0,0 +1,33 @@
+#include "PrionEnsemble.hpp"
+
+// Main function: solve an ensemble of problems that differ in the position of
+// the seed and in the coefficient alpha.
+int
+main(int argc, char *argv[]) {
+  Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv);
+
+  const unsigned int N      = 19;
+  const unsigned int degree = 1;
+
+  const double T      = 15.0;
+  const double deltat = 0.1;
+
+  using Point3 = Point<HeatNonLinear::dim>;
+
+  const std::vector<HeatNonLinearEnsemble::Member> members = {
+    {HeatNonLinear::FunctionU0(Point3(50, 80, 70)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(50, 80, 70)), 1.0},
+    {HeatNonLinear::FunctionU0(Point3(48, 80, 70)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(52, 80, 70)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(50, 78, 70)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(50, 82, 70)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(50, 80, 68)), 2.0},
+    {HeatNonLinear::FunctionU0(Point3(50, 80, 72)), 2.0}};
+
+  HeatNonLinearEnsemble problem(N, degree, T, deltat, members);
+
+  problem.setup();
+  problem.solve();
+
+  return 0;
+}
@@ -13,6 +13,65 @@ main(int argc, char *argv[]) {
 
   HeatNonLinear problem(N, degree, T, deltat);
 
+  // Checkpoint every 10 time steps; to continue an interrupted run, restart
+  // from the same directory (before enabling the CSV files below, so that
+  // they are appended to).
+  // problem.set_checkpointing("/scratch/hpc/par1/checkpoint/", 10);
+  // problem.set_restart("/scratch/hpc/par1/checkpoint/");
+
+  // Build the serial mesh on one process per node (the default); a larger
+  // group lowers the memory of the node further.
+  // problem.set_mesh_group_size(16);
+
+  problem.set_telemetry_file("telemetry.csv");
+
+  // Mass, affected volume and front position after every time step. With
+  // these, full-field output can be made rare (or disabled with frequency 0).
+  problem.set_diagnostics_file("diagnostics.csv");
+
+  // Concentration at given landmarks after every time step.
+  // problem.set_probes({Point<HeatNonLinear::dim>(50, 80, 70),
+  //                     Point<HeatNonLinear::dim>(60, 80, 70)},
+  //                    "probes.csv");
+
+  // All the processes write the output file, whose flush is deferred to
+  // checkpoints and to the end of the run.
+  // problem.set_output_directory("/scratch/hpc/par1/out/");
+  // problem.set_asynchronous_output(false);
+
+  // Output every 3 time units (independently of the time step), and once the
+  // front reaches 20 mm from the seed.
+  // problem.set_output_frequency(0);
+  // problem.set_output_interval(3.0);
+  // problem.add_output_trigger(Point<HeatNonLinear::dim>(70, 80, 70), 2.0, 0.5);
+  // problem.set_output_times({1.0, 2.5, 5.0});
+
+  // Lossless compression of the output. ZFP keeps the error on u below the
+  // given bound, and needs the H5Z-ZFP plugin.
+  // problem.set_output_compression(SolutionWriter::Compression::Deflate);
+  // problem.set_output_compression(SolutionWriter::Compression::ZFP, 1e-4);
+
+  // Adaptive time stepping, starting from deltat, with local error tolerance
+  // 1e-3 (the solution ranges in [0, 1]). The maximum step stays below
+  // 1 / alpha = 0.5, so that the Jacobian of backward Euler remains positive
+  // definite where u is small.
+  // problem.set_adaptive_time_stepping(1e-3, 0.4, 1e-3);
+
+  // Stop once 99% of the domain is saturated.
+  // problem.set_stopping_criterion(0.0, 0.0, 0.99);
+
+  // Lumped mass, with nodal reaction term.
+  // problem.set_mass_lumping(true);
+
+  // Second order time discretization.
+  // problem.set_time_scheme(HeatNonLinear::TimeScheme::BDF2);
+
+#ifdef PRION_PERF_COUNTERS
+  // Count the double precision operations (scalar, 128 and 256 bit packed
+  // instructions) on Intel processors.
+  // problem.set_flop_events({{0x01c7, 1.0}, {0x04c7, 2.0}, {0x10c7, 4.0}});
+#endif
+
   problem.setup();
   problem.solve();
 
@@ -0,0 +1,232 @@
+#include "Prion.hpp"
+
+// Parareal driver. MPI_COMM_WORLD is split into groups of processes, one per
+// time slice, and each group solves the problem in space on its own
+// communicator. The coarse propagator G is Strang splitting with a large time
+// step, and the fine propagator F is backward Euler with the time step of the
+// sequential solver. At iteration k, the start value of slice n is corrected
+// as
+//   U_{k+1}^{n+1} = G(U_{k+1}^n) + F(U_k^n) - G(U_k^n).
+//
+// Start values are exchanged between corresponding processes of neighboring
+// groups: since all groups have the same size and partition the same mesh in
+// the same way, they own the same DoFs.
+//
+// Usage: parareal <number of time slices> [reference]. With "reference", the
+// sequential solver is also run on all the processes, and the speedup of
+// Parareal is reported.
+int
+main(int argc, char *argv[]) {
+  Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv);
+
+  const unsigned int world_size = Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
+  const unsigned int world_rank = Utilities::MPI::this_mpi_process(MPI_COMM_WORLD);
+  ConditionalOStream pcout(std::cout, world_rank == 0);
+
+  const unsigned int n_slices       = argc > 1 ? std::stoi(argv[1]) : 2;
+  const bool         run_reference  = argc > 2 && std::string(argv[2]) == "reference";
+  const unsigned int max_iterations = n_slices;
+  const double       tolerance      = 1e-6;
+
+  AssertThrow(n_slices > 0 && world_size % n_slices == 0,
+              ExcMessage("The number of processes must be a multiple of the number of "
+                         "time slices."));
+
+  const unsigned int N      = 19;
+  const unsigned int degree = 1;
+
+  const double T             = 15.0;
+  const double deltat_fine   = 0.1;
+  const double deltat_coarse = 0.5;
+
+  const unsigned int group_size = world_size / n_slices;
+  const unsigned int slice      = world_rank / group_size;
+
+  MPI_Comm slice_comm;
+  MPI_Comm_split(MPI_COMM_WORLD, slice, world_rank, &slice_comm);
+
+  const double slice_start = T * slice / n_slices;
+  const double slice_end   = T * (slice + 1) / n_slices;
+
+  Timer parareal_watch;
+
+  double                        parareal_norm = 0.0;
+  TrilinosWrappers::MPI::Vector start_value;
+  {
+    HeatNonLinear problem(N, degree, T, deltat_fine, slice_comm);
+    problem.set_output_frequency(0);
+    problem.setup();
+
+    // Propagate u from t_0 to t_1 with the given scheme and time step.
+    const auto propagate = [&](const TrilinosWrappers::MPI::Vector &u,
+                               const double                        &t_0,
+                               const double                        &t_1,
+                               const HeatNonLinear::TimeScheme     &scheme,
+                               const double                        &deltat) {
+      problem.set_time_scheme(scheme);
+      problem.set_time_step(std::min(deltat, t_1 - t_0));
+      problem.set_state(u, t_0);
+      problem.advance(t_1);
+
+      TrilinosWrappers::MPI::Vector result(start_value);
+      result = problem.get_solution();
+      return result;
+    };
+
+    const auto coarse = [&](const TrilinosWrappers::MPI::Vector &u) {
+      return propagate(u,
+                       slice_start,
+                       slice_end,
+                       HeatNonLinear::TimeScheme::StrangSplitting,
+                       deltat_coarse);
+    };
+
+    const auto fine = [&](const TrilinosWrappers::MPI::Vector &u) {
+      return propagate(
+        u, slice_start, slice_end, HeatNonLinear::TimeScheme::BackwardEuler, deltat_fine);
+    };
+
+    // Send and receive start values to and from the corresponding process of
+    // the next and previous slices.
+    const auto send_to_next = [&](TrilinosWrappers::MPI::Vector &u) {
+      MPI_Send(u.begin(),
+               static_cast<int>(u.end() - u.begin()),
+               MPI_DOUBLE,
+               world_rank + group_size,
+               0,
+               MPI_COMM_WORLD);
+    };
+
+    const auto receive_from_previous = [&](TrilinosWrappers::MPI::Vector &u) {
+      const int  size = static_cast<int>(u.end() - u.begin());
+      MPI_Status status;
+      MPI_Recv(
+        u.begin(), size, MPI_DOUBLE, world_rank - group_size, 0, MPI_COMM_WORLD, &status);
+
+      int count = 0;
+      MPI_Get_count(&status, MPI_DOUBLE, &count);
+      AssertThrow(count == size,
+                  ExcMessage("Received " + std::to_string(count) + " values instead of " +
+                             std::to_string(size) + " from the previous slice."));
+    };
+
+    // Initial guess of the start value, with a coarse sweep from the initial
+    // condition (each slice computes its own redundantly).
+    problem.apply_initial_condition();
+    start_value.reinit(problem.get_solution().locally_owned_elements(), slice_comm);
+    start_value = problem.get_solution();
+
+    // The values are exchanged between corresponding processes of consecutive
+    // slices, which must then own the same DoFs: this is checked once, by
+    // comparing the size and the range of the locally owned DoFs.
+    {
+      const IndexSet &owned = start_value.locally_owned_elements();
+
+      std::array<unsigned long long, 4> local = {
+        {owned.n_elements(),
+         owned.n_elements() > 0 ? owned.nth_index_in_set(0) : 0,
+         owned.n_elements() > 0 ? owned.nth_index_in_set(owned.n_elements() - 1) : 0,
+         owned.n_intervals()}};
+      std::array<unsigned long long, 4> previous = local;
+
+      MPI_Sendrecv(local.data(),
+                   local.size(),
+                   MPI_UNSIGNED_LONG_LONG,
+                   slice + 1 < n_slices ? world_rank + group_size : MPI_PROC_NULL,
+                   1,
+                   previous.data(),
+                   previous.size(),
+                   MPI_UNSIGNED_LONG_LONG,
+                   slice > 0 ? world_rank - group_size : MPI_PROC_NULL,
+                   1,
+                   MPI_COMM_WORLD,
+                   MPI_STATUS_IGNORE);
+
+      const unsigned int matching =
+        Utilities::MPI::min(previous == local ? 1u : 0u, MPI_COMM_WORLD);
+      AssertThrow(matching == 1,
+                  ExcMessage("The locally owned DoFs differ between corresponding "
+                             "processes of consecutive time slices."));
+    }
+
+      for (unsigned int n = 0; n < slice; ++n) {
+        start_value = propagate(start_value,
+                                T * n / n_slices,
+                                T * (n + 1) / n_slices,
+                                HeatNonLinear::TimeScheme::StrangSplitting,
+                                deltat_coarse);
+      }
+
+    TrilinosWrappers::MPI::Vector coarse_old = coarse(start_value);
+    TrilinosWrappers::MPI::Vector end_value  = coarse_old;
+
+      for (unsigned int k = 0; k < max_iterations; ++k) {
+        const TrilinosWrappers::MPI::Vector fine_value = fine(start_value);
+
+        // Sequential correction sweep. The first slice always starts from the
+        // exact initial condition.
+        TrilinosWrappers::MPI::Vector start_value_new(start_value);
+        if (slice > 0)
+          receive_from_previous(start_value_new);
+
+        const TrilinosWrappers::MPI::Vector coarse_new = coarse(start_value_new);
+
+        end_value = coarse_new;
+        end_value += fine_value;
+        end_value -= coarse_old;
+
+        if (slice + 1 < n_slices)
+          send_to_next(end_value);
+
+        // Relative change of the start values.
+        TrilinosWrappers::MPI::Vector change(start_value_new);
+        change -= start_value;
+        const double slice_change =
+          change.l2_norm() / std::max(start_value_new.l2_norm(), 1e-30);
+        const double max_change = Utilities::MPI::max(slice_change, MPI_COMM_WORLD);
+
+        start_value = start_value_new;
+        coarse_old  = coarse_new;
+
+        pcout << "Parareal iteration " << k + 1 << ": max relative change = "
+              << std::scientific << max_change << std::endl;
+
+        // After k + 1 iterations, the first k + 1 slices are exact.
+        if ((k > 0 && max_change < tolerance) || k + 1 == n_slices)
+          break;
+      }
+
+    // Norm of the final solution, computed on the last slice.
+    const double last_norm = end_value.l2_norm();
+    parareal_norm =
+      Utilities::MPI::max(slice + 1 == n_slices ? last_norm : 0.0, MPI_COMM_WORLD);
+  }
+
+  const double parareal_time = parareal_watch.wall_time();
+
+  pcout << "===============================================" << std::endl;
+  pcout << "Parareal: " << n_slices << " slices of " << group_size << " processes, "
+        << std::fixed << std::setprecision(2) << parareal_time << " s" << std::endl;
+
+    if (run_reference) {
+      Timer reference_watch;
+
+      HeatNonLinear problem(N, degree, T, deltat_fine);
+      problem.set_output_frequency(0);
+      problem.setup();
+      problem.solve();
+
+      const double reference_time = reference_watch.wall_time();
+      const double reference_norm = problem.get_solution().l2_norm();
+
+      pcout << "Sequential in time: " << world_size << " processes, " << reference_time
+            << " s" << std::endl;
+      pcout << "Speedup: " << reference_time / parareal_time << std::endl;
+      pcout << "Relative difference of the final ||u||: " << std::scientific
+            << std::abs(parareal_norm - reference_norm) / reference_norm << std::endl;
+    }
+
+  MPI_Comm_free(&slice_comm);
+
+  return 0;
+}